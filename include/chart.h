@@ -0,0 +1,25 @@
+#pragma once
+#include "config.h"
+#include "display.h"
+
+// Strip chart in a hardware scroll area. Time runs down the screen: every
+// sample is one row with the value as a horizontal position, joined to the
+// previous one. A new sample rewrites the oldest row and scrolls it to the
+// bottom, so it costs one row of pixels and a scroll address update. The
+// widget owns the scroll area, other drawing belongs above or below it.
+typedef struct {
+    uint16_t top;           // First row of the scroll area
+    uint16_t lines;         // Samples on screen
+    int32_t min;            // Value shown in the first column
+    int32_t max;            // Value shown in the last column
+    uint16_t color;
+    uint16_t back_color;
+    uint16_t line;          // GRAM row shown at the top, the oldest sample
+    uint16_t column;        // Column of the previous sample
+    bool started;
+    display_list_t list;    // A sample is submitted as one list, keep the chart static
+} chart_t;
+
+extern void chart_init(chart_t *chart, uint16_t top, uint16_t lines, int32_t min, int32_t max, uint16_t color, uint16_t back_color);
+extern display_fence_t chart_add_sample(chart_t *chart, int32_t value);
+extern void chart_release(chart_t *chart);
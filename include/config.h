@@ -9,6 +9,7 @@
 #include <libopencm3/cm3/cortex.h>
 #include <libopencm3/cm3/systick.h>
 #include <libopencm3/cm3/scb.h>
+#include <libopencm3/cm3/dwt.h>
 
 #include <libopencm3/stm32/f4/rcc.h>
 #include <libopencm3/stm32/f4/gpio.h>
@@ -16,6 +17,7 @@
 #include <libopencm3/stm32/f4/nvic.h>
 #include <libopencm3/stm32/f4/spi.h>
 #include <libopencm3/stm32/f4/dma.h>
+#include <libopencm3/stm32/exti.h>
 
 #include <FreeRTOS.h>
 #include <task.h>
@@ -45,6 +47,12 @@
 
 #define DISPLAY_BL_PORT      GPIOA
 #define DISPLAY_BL_PIN       GPIO10
+
+#define DISPLAY_TE_PORT      GPIOA
+#define DISPLAY_TE_PIN       GPIO1
+#define DISPLAY_TE_EXTI      EXTI1
+#define DISPLAY_TE_IRQ       NVIC_EXTI1_IRQ
+#define DISPLAY_TE_ISR       exti1_isr
   
 #define DISPLAY_SPI_PORT     GPIOB
 #define DISPLAY_CS_PIN       GPIO12
@@ -67,6 +75,69 @@
 #define DISPLAY_GLIPH_WIDTH  32
 #define DISPLAY_GLIPH_HEIGHT 48
 
+// Glyphs drawn through one window, longer strings are split into several runs
+#define DISPLAY_TEXT_RUN     8
+
+// Colorized glyphs kept in RAM for text drawn again and again in the same
+// colors: bytes of pixels and glyphs at most, a size of 0 disables the cache.
+// An entry takes the ink rows of a cell, e.g. 3 KB for a digit of fira_code.
+#define DISPLAY_GLIPH_CACHE_SIZE       16384
+#define DISPLAY_GLIPH_CACHE_ENTRIES    16
+
+// Command ring in bytes, a power of two. A single command takes at most half
+// of it, longer strings are split.
+#define DISPLAY_RING_SIZE              1024
+
+// What a display_* call does when the ring is full: DISPLAY_POLICY_BLOCK waits
+// up to DISPLAY_POLICY_TIMEOUT ticks, DISPLAY_POLICY_DROP gives up at once and
+// DISPLAY_POLICY_OVERWRITE replaces a pending command for the same area.
+// Records up to DISPLAY_RECORD_COPY bytes can overwrite.
+#define DISPLAY_POLICY                 DISPLAY_POLICY_BLOCK
+#define DISPLAY_POLICY_TIMEOUT         portMAX_DELAY
+#define DISPLAY_RECORD_COPY            96
+
+// Compositor: commands taken from the ring at once, drawn commands kept to
+// recognize redraws that would not change the panel. Only records up to
+// DISPLAY_RECORD_COPY bytes are kept.
+#define DISPLAY_COMPOSITOR_BATCH       16
+#define DISPLAY_COMPOSITOR_RETAINED    8
+
+// DISPLAY_RENDER_DIRECT draws every command through windows of its own,
+// DISPLAY_RENDER_BANDS rasterizes each batch in bands of the DMA buffers
+#define DISPLAY_RENDER_MODE            DISPLAY_RENDER_DIRECT
+
+// Power management: after DISPLAY_POWER_TIMEOUT ticks without drawing outside
+// the status strip the panel shows only the strip (partial mode) in 8 colors
+// (idle mode), and strip updates are drawn once per DISPLAY_POWER_PERIOD
+// ticks. A timeout of 0 keeps the panel in normal mode, see
+// display_set_power_policy().
+#define DISPLAY_POWER_TIMEOUT          0
+#define DISPLAY_POWER_PERIOD           pdMS_TO_TICKS(1000)
+
+// Tear-free updates: windows of at least DISPLAY_VSYNC_PIXELS start right
+// behind the panel scan. DISPLAY_VSYNC_TE times the scan from the TE line,
+// DISPLAY_VSYNC_TIMER from SLPOUT or the last TE edge and the period alone,
+// see display_set_vsync(). The timer is only as good as DISPLAY_FRAME_CYCLES:
+// the scan moves away from it by the error of the panel oscillator every
+// frame, and tearing comes back once it is off by more than the margin.
+// A frame is DISPLAY_FRAME_LINES lines (the rows and the PORCTRL porches), TE
+// rises DISPLAY_FRAME_BLANK lines before row 0. A pixel takes
+// DISPLAY_PIXEL_CYCLES on the bus (16 bits at SCK = HCLK / 4).
+#define DISPLAY_VSYNC                  DISPLAY_VSYNC_OFF
+#define DISPLAY_VSYNC_PIXELS           256
+#define DISPLAY_FRAME_CYCLES           (configCPU_CLOCK_HZ / 60)
+#define DISPLAY_FRAME_LINES            344
+#define DISPLAY_FRAME_BLANK            24
+#define DISPLAY_PIXEL_CYCLES           64
+
+// Display lists: bytes and commands one list can record. A list is a single
+// record in the ring and is composed as a whole, so it has to fit both.
+#define DISPLAY_LIST_SIZE              448
+#define DISPLAY_LIST_COMMANDS          DISPLAY_COMPOSITOR_BATCH
+
+// Cells of a display_text_field_t
+#define DISPLAY_TEXT_FIELD_CELLS       16
+
 
 
 // USB
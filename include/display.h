@@ -1,7 +1,10 @@
 
 #pragma once
+#include <stddef.h>
+
 #include "config.h"
 #include "fonts.h"
+#include "images.h"
 
 #define COLOR_BLACK   0x0000
 #define COLOR_WHITE   0xFFFF
@@ -18,9 +21,116 @@
 // Pack Red, Green, and Blue components into RGB565 
 #define PACK_RGB565(r, g, b) (((r * 31 / 255) << 11) | ((g * 63 / 255) << 5) | (b * 31 / 255))
 
-extern void display_fill_screen(uint16_t color);
-extern void display_fill_rect(uint16_t color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom);
-extern void display_draw_rect(uint16_t color, uint16_t border_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom);
-extern void display_draw_text(const font_t *font, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, wchar_t *text);
+// Sequence number of a submitted command, it is reached once the display task
+// has drawn (or dropped) the command and everything submitted before it
+typedef uint32_t display_fence_t;
+
+// Returned for a command that did not fit into the ring
+#define DISPLAY_FENCE_NONE  0
+
+typedef enum {
+    DISPLAY_POLICY_BLOCK,       // Wait for space, up to the policy timeout
+    DISPLAY_POLICY_DROP,        // Drop the new command
+    DISPLAY_POLICY_OVERWRITE,   // Replace a pending command for the same area, else drop
+} display_policy_t;
+
+typedef enum {
+    DISPLAY_RENDER_DIRECT,      // One or more windows per command
+    DISPLAY_RENDER_BANDS,       // A batch is rasterized into bands, one window per painted area
+} display_render_mode_t;
+
+typedef enum {
+    DISPLAY_VSYNC_OFF,          // Windows are written as soon as they come
+    DISPLAY_VSYNC_TE,           // Large windows follow the scan, timed from the TE line
+    DISPLAY_VSYNC_TIMER,        // ... timed from SLPOUT or the last TE edge, for a panel without TE
+} display_vsync_t;
+
+typedef struct {
+    uint32_t commands;          // Received by the display task
+    uint32_t lists;             // Display lists among them
+    uint32_t commands_dropped;  // Overdrawn later in the same batch or redrawn unchanged
+    uint32_t commands_merged;   // Fills joined with the previous fill of the same color
+    uint32_t commands_rejected; // Not queued, the ring was full
+    uint32_t commands_replaced; // Written over a pending command for the same area
+    uint32_t pixels_submitted;  // Area of every received command
+    uint32_t pixels_drawn;      // Area actually sent to the panel
+    uint32_t queue_depth;       // Commands submitted but not drawn yet
+    uint32_t queue_depth_max;
+    uint32_t ring_bytes_max;    // Ring usage high-water mark
+    uint32_t stalls;            // Submits that waited for space
+    uint32_t stall_ticks;       // Total time spent waiting
+    uint32_t stall_ticks_max;
+    uint32_t wakeups;           // Times the display task woke up to draw
+    uint32_t low_power_entries; // Switches to partial and idle mode
+    uint32_t vsync_windows;     // Windows started right behind the panel scan
+    uint32_t vsync_late;        // ... of them not written before the scan came round again
+    uint32_t vsync_wait_us_max; // Longest wait for the scan
+    uint32_t frame_us;          // Refresh period, measured from TE
+    uint32_t gliph_cache_hits;  // Glyphs sent straight from the glyph cache
+    uint32_t gliph_cache_misses;
+    uint32_t gliph_cache_evictions;
+    uint32_t gliph_cache_entries;
+    uint32_t gliph_cache_bytes; // In use, of DISPLAY_GLIPH_CACHE_SIZE
+} display_stats_t;
+
+// Fixed-position text that only resends the cells whose character or colors
+// changed since the previous update
+typedef struct {
+    const font_t *font;
+    uint16_t left;
+    uint16_t top;
+    size_t cells;
+    bool valid;
+    wchar_t text[DISPLAY_TEXT_FIELD_CELLS];
+    uint16_t fore_color[DISPLAY_TEXT_FIELD_CELLS];
+    uint16_t back_color[DISPLAY_TEXT_FIELD_CELLS];
+} display_text_field_t;
+
+// Commands recorded by the caller and submitted at once. The display task
+// composes them as one batch and draws nothing else in between. At about half
+// a kilobyte it is better kept static than on a task stack.
+typedef struct {
+    size_t size;
+    size_t count;
+    uint8_t records[DISPLAY_LIST_SIZE] __attribute__((aligned(_Alignof(max_align_t))));
+} display_list_t;
+
+extern display_fence_t display_fill_screen(uint16_t color);
+extern display_fence_t display_fill_rect(uint16_t color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom);
+extern display_fence_t display_draw_rect(uint16_t color, uint16_t border_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t border);
+extern display_fence_t display_fill_round_rect(uint16_t color, uint16_t back_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t radius);
+extern display_fence_t display_fill_circle(uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, uint16_t radius);
+extern display_fence_t display_draw_arc(uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, uint16_t radius, uint16_t thickness, uint16_t start, uint16_t end);
+extern display_fence_t display_draw_text(const font_t *font, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, const wchar_t *text);
+extern display_fence_t display_draw_image(const image_t *image, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y);
+extern display_fence_t display_set_scroll_area(uint16_t top, uint16_t lines);
+extern display_fence_t display_scroll(uint16_t line);
+extern display_fence_t display_set_clip(uint16_t left, uint16_t right, uint16_t top, uint16_t bottom);
+
+extern void display_list_begin(display_list_t *list);
+extern bool display_list_fill_screen(display_list_t *list, uint16_t color);
+extern bool display_list_fill_rect(display_list_t *list, uint16_t color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom);
+extern bool display_list_draw_rect(display_list_t *list, uint16_t color, uint16_t border_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t border);
+extern bool display_list_fill_round_rect(display_list_t *list, uint16_t color, uint16_t back_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t radius);
+extern bool display_list_fill_circle(display_list_t *list, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, uint16_t radius);
+extern bool display_list_draw_arc(display_list_t *list, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, uint16_t radius, uint16_t thickness, uint16_t start, uint16_t end);
+extern bool display_list_draw_text(display_list_t *list, const font_t *font, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, const wchar_t *text);
+extern bool display_list_draw_image(display_list_t *list, const image_t *image, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y);
+extern bool display_list_scroll(display_list_t *list, uint16_t line);
+extern bool display_list_set_clip(display_list_t *list, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom);
+extern display_fence_t display_list_submit(display_list_t *list);
+
+extern void display_set_power_policy(uint16_t top, uint16_t bottom, TickType_t timeout);
+extern void display_wake(void);
+extern void display_set_render_mode(display_render_mode_t mode);
+extern void display_set_vsync(display_vsync_t mode);
+extern void display_set_policy(display_policy_t policy, TickType_t timeout);
+extern bool display_fence_reached(display_fence_t fence);
+extern bool display_fence_wait(display_fence_t fence, TickType_t timeout);
+
+extern void display_text_field_init(display_text_field_t *field, const font_t *font, uint16_t x, uint16_t y, size_t cells);
+extern void display_text_field_invalidate(display_text_field_t *field);
+extern size_t display_text_field_set(display_text_field_t *field, uint16_t color, uint16_t back_color, const wchar_t *text);
+extern void display_get_stats(display_stats_t *stats);
 
 extern void display_setup(void);
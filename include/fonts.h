@@ -6,20 +6,47 @@
 #include <stdint.h>
 #include <stdlib.h>
 
-typedef struct gliph_t{
+// Printable ASCII glyphs are looked up by direct index
+#define FONT_ASCII_FIRST 0x20
+#define FONT_ASCII_LAST  0x7E
+
+// Glyph data starts with the ink box (gliph_box_t), pixels outside of it are
+// blank and not stored. The box follows as 4-bit alpha, row after row, coded
+// in byte tokens:
+//   00nnnnnn            n + 1 pixels of alpha 0
+//   01nnnnnn            n + 1 pixels of alpha 15
+//   1nnnnnnn <nibbles>  n + 1 literal pixels, two per byte, high nibble first
+// Runs may continue on the next row, a literal always ends on a byte boundary.
+#define FONT_TOKEN_LITERAL  0x80
+#define FONT_TOKEN_FULL     0x40
+#define FONT_TOKEN_ZERO     0x00
+#define FONT_RUN_MASK       0x3F
+#define FONT_LITERAL_MASK   0x7F
+#define FONT_ALPHA_MAX      15
+
+typedef struct {
+    uint8_t left;
+    uint8_t top;
+    uint8_t width;      // 0 if the glyph has no ink at all
+    uint8_t height;
+} gliph_box_t;
+
+typedef struct {
     const wchar_t key;
     const uint8_t * const data;
-    const struct gliph_t * const next;
 } gliph_t;
 
 typedef struct {
     const uint16_t height;
     const uint16_t width;
     const uint16_t baseline;
-    const gliph_t * const gliph;
+    const uint8_t * const * const ascii;    // FONT_ASCII_FIRST..FONT_ASCII_LAST, NULL if missing
+    const gliph_t * const gliph;            // Everything else, sorted by key
+    const uint16_t gliph_count;
 } font_t;
 
 extern const uint8_t *font_gliph(const font_t *font, const wchar_t ch);
+extern void font_gliph_alpha(const font_t *font, const uint8_t *data, uint8_t *alpha);
 
 extern const uint8_t fira_code_data[];
 extern const font_t fira_code;
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "fonts.h"
+
+// Image data stays in flash and is streamed to the panel as it is drawn.
+// Indexed pixels are packed most significant bits first, each row starts on a
+// byte boundary and indexes the RGB565 palette. RGB565 pixels are words the
+// DMA sends as they are. Alpha images are coded like a glyph of the image
+// size (see fonts.h): an ink box followed by 4-bit alpha tokens, colored when
+// drawn like text.
+typedef enum {
+    IMAGE_FORMAT_INDEX1,
+    IMAGE_FORMAT_INDEX2,
+    IMAGE_FORMAT_INDEX4,
+    IMAGE_FORMAT_INDEX8,
+    IMAGE_FORMAT_RGB565,
+    IMAGE_FORMAT_ALPHA,
+} image_format_t;
+
+// Bits per pixel of an indexed format
+#define IMAGE_INDEX_BITS(format)    (1u << (format))
+
+typedef struct {
+    const uint16_t width;
+    const uint16_t height;
+    const uint8_t format;                   // image_format_t
+    const uint16_t colors;                  // Palette entries, 0 unless indexed
+    const uint16_t * const palette;
+    const uint8_t * const data;
+} image_t;
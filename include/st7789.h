@@ -19,6 +19,12 @@
 #define ST7789_RAMRD   0x2E
 
 #define ST7789_PTLAR   0x30
+#define ST7789_VSCRDEF 0x33
+#define ST7789_TEOFF   0x34
+#define ST7789_TEON    0x35
+#define ST7789_VSCSAD  0x37
+#define ST7789_IDMOFF  0x38
+#define ST7789_IDMON   0x39
 #define ST7789_COLMOD  0x3A
 #define ST7789_MADCTL  0x36
 
@@ -33,6 +39,12 @@
 /* RGB/BGR Order ('0' = RGB, '1' = BGR) */
 #define ST7789_MADCTL_RGB 0x08
 
+/* TEON: TE pulses in the vertical blanking only */
+#define ST7789_TE_VBLANK 0x00
+
+/* Gate lines of the controller, VSCRDEF areas add up to it */
+#define ST7789_LINES   320
+
 #define ST7789_RDID1   0xDA
 #define ST7789_RDID2   0xDB
 #define ST7789_RDID3   0xDC
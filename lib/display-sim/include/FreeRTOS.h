@@ -0,0 +1,34 @@
+#pragma once
+// Host stand-in for the FreeRTOS kernel.
+//
+// The simulator runs the display pipeline on a single host thread: nothing is
+// preempted, and blocking calls advance simulated time to the next hardware
+// event (DMA completion, SPI interrupt) instead of switching tasks.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef long                BaseType_t;
+typedef unsigned long       UBaseType_t;
+typedef uint64_t            TickType_t;
+
+#define pdFALSE             ( ( BaseType_t ) 0 )
+#define pdTRUE              ( ( BaseType_t ) 1 )
+#define pdPASS              ( pdTRUE )
+#define pdFAIL              ( pdFALSE )
+#define errQUEUE_EMPTY      ( ( BaseType_t ) 0 )
+#define errQUEUE_FULL       ( ( BaseType_t ) 0 )
+
+#define portMAX_DELAY       ( ( TickType_t ) UINT64_MAX )
+#define portTICK_PERIOD_MS  ( ( TickType_t ) 1 )
+
+#define configCPU_CLOCK_HZ                  84000000
+#define configTICK_RATE_HZ                  1000
+#define configKERNEL_INTERRUPT_PRIORITY     0xF0
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY 0x70
+
+#define pdMS_TO_TICKS( xTimeInMs )          ( ( TickType_t ) ( xTimeInMs ) )
+
+#define configASSERT( x ) if ((x) == 0) __assert(__FILE__, __LINE__, "")
+
+void __assert(const char *file, const int line, char *failedexpr);
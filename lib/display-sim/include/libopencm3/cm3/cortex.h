@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in for <libopencm3/cm3/cortex.h>
+
+static inline void cm_enable_interrupts(void) {}
+static inline void cm_disable_interrupts(void) {}
@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in for <libopencm3/cm3/dwt.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The cycle counter follows simulated time at HCLK
+bool dwt_enable_cycle_counter(void);
+uint32_t dwt_read_cycle_counter(void);
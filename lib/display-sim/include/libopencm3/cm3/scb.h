@@ -0,0 +1,2 @@
+#pragma once
+// Host stand-in for <libopencm3/cm3/scb.h>
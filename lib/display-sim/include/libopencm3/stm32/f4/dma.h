@@ -0,0 +1,65 @@
+#pragma once
+// Host stand-in for <libopencm3/stm32/f4/dma.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DMA1                                (0x40026000U)
+#define DMA2                                (0x40026400U)
+
+#define DMA_STREAM0                         0
+#define DMA_STREAM1                         1
+#define DMA_STREAM2                         2
+#define DMA_STREAM3                         3
+#define DMA_STREAM4                         4
+#define DMA_STREAM5                         5
+#define DMA_STREAM6                         6
+#define DMA_STREAM7                         7
+
+#define DMA_LIFCR(port)                     (*sim_dma_ifcr(port, false))
+#define DMA_HIFCR(port)                     (*sim_dma_ifcr(port, true))
+
+#define DMA_FEIF                            (1 << 0)
+#define DMA_DMEIF                           (1 << 2)
+#define DMA_TEIF                            (1 << 3)
+#define DMA_HTIF                            (1 << 4)
+#define DMA_TCIF                            (1 << 5)
+#define DMA_ISR_OFFSET(stream)              (6 * ((stream) & 0x01) + 16 * (((stream) & 0x02) >> 1))
+#define DMA_ISR_MASK(stream)                (0x3d << DMA_ISR_OFFSET(stream))
+
+#define DMA_SxCR_DIR_PERIPHERAL_TO_MEM      (0 << 6)
+#define DMA_SxCR_DIR_MEM_TO_PERIPHERAL      (1 << 6)
+#define DMA_SxCR_PSIZE_8BIT                 (0 << 11)
+#define DMA_SxCR_PSIZE_16BIT                (1 << 11)
+#define DMA_SxCR_MSIZE_8BIT                 (0 << 13)
+#define DMA_SxCR_MSIZE_16BIT                (1 << 13)
+#define DMA_SxCR_PL_LOW                     (0 << 16)
+#define DMA_SxCR_PL_VERY_HIGH               (3 << 16)
+#define DMA_SxCR_CHSEL_0                    (0 << 25)
+#define DMA_SxFCR_FTH_4_4_FULL              (3 << 0)
+
+volatile uint32_t *sim_dma_ifcr(uint32_t dma, bool high);
+
+void dma_stream_reset(uint32_t dma, uint8_t stream);
+void dma_set_transfer_mode(uint32_t dma, uint8_t stream, uint32_t direction);
+void dma_set_peripheral_size(uint32_t dma, uint8_t stream, uint32_t peripheral_size);
+void dma_set_memory_size(uint32_t dma, uint8_t stream, uint32_t memory_size);
+void dma_enable_memory_increment_mode(uint32_t dma, uint8_t stream);
+void dma_disable_memory_increment_mode(uint32_t dma, uint8_t stream);
+void dma_disable_peripheral_increment_mode(uint32_t dma, uint8_t stream);
+void dma_enable_transfer_complete_interrupt(uint32_t dma, uint8_t stream);
+void dma_disable_transfer_complete_interrupt(uint32_t dma, uint8_t stream);
+void dma_enable_fifo_mode(uint32_t dma, uint8_t stream);
+void dma_set_fifo_threshold(uint32_t dma, uint8_t stream, uint32_t threshold);
+void dma_set_priority(uint32_t dma, uint8_t stream, uint32_t prio);
+void dma_channel_select(uint32_t dma, uint8_t stream, uint32_t channel);
+void dma_set_peripheral_address(uint32_t dma, uint8_t stream, uint32_t address);
+void dma_set_memory_address(uint32_t dma, uint8_t stream, uint32_t address);
+void dma_set_memory_address_1(uint32_t dma, uint8_t stream, uint32_t address);
+void dma_set_number_of_data(uint32_t dma, uint8_t stream, uint16_t number);
+void dma_enable_double_buffer_mode(uint32_t dma, uint8_t stream);
+void dma_disable_double_buffer_mode(uint32_t dma, uint8_t stream);
+void dma_enable_stream(uint32_t dma, uint8_t stream);
+void dma_disable_stream(uint32_t dma, uint8_t stream);
+bool dma_get_interrupt_flag(uint32_t dma, uint8_t stream, uint32_t interrupts);
+void dma_clear_interrupt_flags(uint32_t dma, uint8_t stream, uint32_t interrupts);
@@ -0,0 +1,51 @@
+#pragma once
+// Host stand-in for <libopencm3/stm32/f4/gpio.h>
+
+#include <stdint.h>
+
+#define GPIOA                   (0x40020000U)
+#define GPIOB                   (0x40020400U)
+#define GPIOC                   (0x40020800U)
+
+#define GPIO0                   (1 << 0)
+#define GPIO1                   (1 << 1)
+#define GPIO2                   (1 << 2)
+#define GPIO3                   (1 << 3)
+#define GPIO4                   (1 << 4)
+#define GPIO5                   (1 << 5)
+#define GPIO6                   (1 << 6)
+#define GPIO7                   (1 << 7)
+#define GPIO8                   (1 << 8)
+#define GPIO9                   (1 << 9)
+#define GPIO10                  (1 << 10)
+#define GPIO11                  (1 << 11)
+#define GPIO12                  (1 << 12)
+#define GPIO13                  (1 << 13)
+#define GPIO14                  (1 << 14)
+#define GPIO15                  (1 << 15)
+
+#define GPIO_MODE_INPUT         0x0
+#define GPIO_MODE_OUTPUT        0x1
+#define GPIO_MODE_AF            0x2
+#define GPIO_MODE_ANALOG        0x3
+
+#define GPIO_PUPD_NONE          0x0
+#define GPIO_PUPD_PULLUP        0x1
+#define GPIO_PUPD_PULLDOWN      0x2
+
+#define GPIO_OTYPE_PP           0x0
+#define GPIO_OTYPE_OD           0x1
+
+#define GPIO_OSPEED_2MHZ        0x0
+#define GPIO_OSPEED_25MHZ       0x1
+#define GPIO_OSPEED_50MHZ       0x2
+#define GPIO_OSPEED_100MHZ      0x3
+
+#define GPIO_AF5                0x5
+
+void gpio_set(uint32_t gpioport, uint16_t gpios);
+void gpio_clear(uint32_t gpioport, uint16_t gpios);
+uint16_t gpio_get(uint32_t gpioport, uint16_t gpios);
+void gpio_mode_setup(uint32_t gpioport, uint8_t mode, uint8_t pull_up_down, uint16_t gpios);
+void gpio_set_output_options(uint32_t gpioport, uint8_t otype, uint8_t speed, uint16_t gpios);
+void gpio_set_af(uint32_t gpioport, uint8_t alt_func_num, uint16_t gpios);
@@ -0,0 +1,34 @@
+#pragma once
+// Host stand-in for <libopencm3/stm32/f4/nvic.h>
+
+#include <stdint.h>
+
+#define NVIC_EXTI0_IRQ          6
+#define NVIC_EXTI1_IRQ          7
+#define NVIC_EXTI2_IRQ          8
+#define NVIC_EXTI3_IRQ          9
+#define NVIC_EXTI4_IRQ          10
+#define NVIC_DMA1_STREAM0_IRQ   11
+#define NVIC_DMA1_STREAM1_IRQ   12
+#define NVIC_DMA1_STREAM2_IRQ   13
+#define NVIC_DMA1_STREAM3_IRQ   14
+#define NVIC_DMA1_STREAM4_IRQ   15
+#define NVIC_DMA1_STREAM5_IRQ   16
+#define NVIC_DMA1_STREAM6_IRQ   17
+#define NVIC_SPI1_IRQ           35
+#define NVIC_SPI2_IRQ           36
+#define NVIC_DMA1_STREAM7_IRQ   47
+#define NVIC_DMA2_STREAM0_IRQ   56
+#define NVIC_DMA2_STREAM1_IRQ   57
+#define NVIC_DMA2_STREAM2_IRQ   58
+#define NVIC_DMA2_STREAM3_IRQ   59
+#define NVIC_DMA2_STREAM4_IRQ   60
+#define NVIC_DMA2_STREAM5_IRQ   68
+#define NVIC_DMA2_STREAM6_IRQ   69
+#define NVIC_DMA2_STREAM7_IRQ   70
+
+#define NVIC_IRQ_COUNT          91
+
+void nvic_enable_irq(uint8_t irqn);
+void nvic_disable_irq(uint8_t irqn);
+void nvic_set_priority(uint8_t irqn, uint8_t priority);
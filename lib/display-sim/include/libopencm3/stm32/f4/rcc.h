@@ -0,0 +1,2 @@
+#pragma once
+// Host stand-in for <libopencm3/stm32/f4/rcc.h>
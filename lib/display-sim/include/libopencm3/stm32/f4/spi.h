@@ -0,0 +1,51 @@
+#pragma once
+// Host stand-in for <libopencm3/stm32/f4/spi.h>
+
+#include <stdint.h>
+
+#define SPI1                                (0x40013000U)
+#define SPI2                                (0x40003800U)
+
+// Status register reads go through the simulator so polling loops advance time
+#define SPI_SR(spi_base)                    (*sim_spi_sr(spi_base))
+#define SPI_DR(spi_base)                    (*sim_spi_dr(spi_base))
+
+#define SPI_SR_RXNE                         (1 << 0)
+#define SPI_SR_TXE                          (1 << 1)
+#define SPI_SR_OVR                          (1 << 6)
+#define SPI_SR_BSY                          (1 << 7)
+
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_2        (0x00 << 3)
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_4        (0x01 << 3)
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_8        (0x02 << 3)
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_16       (0x03 << 3)
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_32       (0x04 << 3)
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_64       (0x05 << 3)
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_128      (0x06 << 3)
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_256      (0x07 << 3)
+
+#define SPI_CR1_CPOL_CLK_TO_0_WHEN_IDLE     (0 << 1)
+#define SPI_CR1_CPOL_CLK_TO_1_WHEN_IDLE     (1 << 1)
+#define SPI_CR1_CPHA_CLK_TRANSITION_1       (0 << 0)
+#define SPI_CR1_CPHA_CLK_TRANSITION_2       (1 << 0)
+#define SPI_CR1_DFF_8BIT                    (0 << 11)
+#define SPI_CR1_DFF_16BIT                   (1 << 11)
+#define SPI_CR1_MSBFIRST                    (0 << 7)
+#define SPI_CR1_LSBFIRST                    (1 << 7)
+
+volatile uint32_t *sim_spi_sr(uint32_t spi);
+volatile uint32_t *sim_spi_dr(uint32_t spi);
+
+int spi_init_master(uint32_t spi, uint32_t br, uint32_t cpol, uint32_t cpha, uint32_t dff, uint32_t lsbfirst);
+void spi_enable(uint32_t spi);
+void spi_disable(uint32_t spi);
+uint16_t spi_clean_disable(uint32_t spi);
+void spi_write(uint32_t spi, uint16_t data);
+void spi_send(uint32_t spi, uint16_t data);
+uint16_t spi_read(uint32_t spi);
+void spi_enable_rx_buffer_not_empty_interrupt(uint32_t spi);
+void spi_disable_rx_buffer_not_empty_interrupt(uint32_t spi);
+void spi_set_dff_8bit(uint32_t spi);
+void spi_set_dff_16bit(uint32_t spi);
+void spi_enable_tx_dma(uint32_t spi);
+void spi_disable_tx_dma(uint32_t spi);
@@ -0,0 +1,11 @@
+#pragma once
+// Host stand-in for FreeRTOS <queue.h>
+
+#include "FreeRTOS.h"
+
+typedef struct sim_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait);
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue);
@@ -0,0 +1,16 @@
+#pragma once
+// Host stand-in for FreeRTOS <semphr.h>
+
+#include "queue.h"
+
+typedef struct sim_semaphore {
+    UBaseType_t count;
+    UBaseType_t max;
+} StaticSemaphore_t;
+
+typedef struct sim_semaphore *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *pxSemaphoreBuffer);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *pxMutexBuffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
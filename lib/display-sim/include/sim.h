@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ST7789 GRAM geometry, independent of the window the firmware uses
+#define SIM_PANEL_WIDTH         240
+#define SIM_PANEL_HEIGHT        320
+
+// Refresh: FRCTRL2 0x0F is nominally 60 Hz, the oscillator of the modelled
+// panel runs 1 % fast. A frame scans the porches (TE is high through them)
+// and then the rows top to bottom, it starts over from SLPOUT on.
+#define SIM_PANEL_FRAME_PS      (SIM_PS_PER_SECOND * 100 / 6060)
+#define SIM_PANEL_BLANK_LINES   24
+#define SIM_PANEL_LINE_PS       (SIM_PANEL_FRAME_PS / (SIM_PANEL_HEIGHT + SIM_PANEL_BLANK_LINES))
+
+// Clock tree of the firmware (84 MHz SYSCLK, APB1 = HCLK / 2)
+#define SIM_HCLK_HZ             84000000ULL
+#define SIM_APB1_HZ             42000000ULL
+#define SIM_APB2_HZ             84000000ULL
+
+#define SIM_PS_PER_SECOND       1000000000000ULL
+#define SIM_PS_PER_TICK         (SIM_PS_PER_SECOND / 1000)
+
+// Cost of one peripheral register access from the CPU
+#define SIM_AHB_ACCESS_PS       (2 * SIM_PS_PER_SECOND / SIM_HCLK_HZ)
+#define SIM_APB1_ACCESS_PS      (2 * SIM_PS_PER_SECOND / SIM_APB1_HZ)
+#define SIM_APB2_ACCESS_PS      (2 * SIM_PS_PER_SECOND / SIM_APB2_HZ)
+
+typedef struct {
+    uint64_t spi_bytes;             // Bytes clocked out on MOSI
+    uint64_t spi_frames;            // SPI data frames (8 or 16 bit)
+    uint64_t dma_transfers;         // DMA stream kicks
+    uint64_t dma_items;             // Items moved by DMA
+    uint64_t dma_items_fixed;       // ... of them repeated from one word (memory increment off)
+    uint64_t windows;               // CASET/RASET/RAMWR sequences (counted at RAMWR)
+    uint64_t pixels_written;        // RAMWR pixels that landed in GRAM
+    uint64_t pixels_discarded;      // RAMWR pixels outside of GRAM
+    uint64_t pixels_overdrawn;      // RAMWR pixels that hit a pixel already written since the reset
+    uint64_t protocol_errors;       // DC/CS toggled mid-frame, lost frames, ...
+    uint64_t torn_frames;           // Refreshes that showed a window partly written
+    uint64_t task_wait_ps;          // Time the task spent blocked on a notification
+    uint64_t isr_ps;                // ... and the CPU spent in interrupt handlers
+} sim_stats_t;
+
+extern sim_stats_t sim_stats;
+extern uint64_t sim_time_ps;
+extern uint16_t sim_framebuffer[SIM_PANEL_HEIGHT][SIM_PANEL_WIDTH];
+
+// Hardware model
+void sim_reset_stats(void);
+void sim_advance(uint64_t until_ps);
+bool sim_wait_event(uint64_t deadline_ps);
+void sim_protocol_error(const char *what);
+uint64_t sim_spi_clock_hz(uint32_t spi);
+
+// Panel model
+void sim_st7789_select(bool selected);
+void sim_st7789_write(uint8_t byte, bool data, uint64_t ps);
+uint64_t sim_st7789_next_te(uint64_t after_ps);
+void sim_st7789_reset_writes(void);
+size_t sim_st7789_scanned_row(size_t y);
+uint16_t sim_st7789_shown_pixel(size_t x, size_t y);
+
+// Output
+bool sim_write_png(const char *path);
+
+// Task model
+extern void (*sim_idle_hook)(void);
+extern struct sim_task *sim_current_task;
+
+// Harness
+void sim_display_start(void);
+void sim_display_pump(void);
+int sim_bench(const char *suite);
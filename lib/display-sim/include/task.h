@@ -0,0 +1,24 @@
+#pragma once
+// Host stand-in for FreeRTOS <task.h>
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct sim_task *TaskHandle_t;
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define taskENTER_CRITICAL_FROM_ISR()       0
+#define taskEXIT_CRITICAL_FROM_ISR( x )     (void) ( x )
+#define portYIELD_FROM_ISR( x )             (void) ( x )
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask);
+void vTaskStartScheduler(void);
+void vTaskDelay(const TickType_t xTicksToDelay);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue, TickType_t xTicksToWait);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken);
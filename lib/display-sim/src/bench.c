@@ -0,0 +1,1426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+
+#include "config.h"
+#include "chart.h"
+#include "display.h"
+#include "display_p.h"
+#include "sim.h"
+#include "st7789.h"
+
+// Benchmark suites, each one prints a CSV table preceded by a "# suite=" line.
+//
+// commands: per-command bus accounting. Every case starts from an idle bus,
+//           submits one API call through the command queue and runs the
+//           display task until the last DMA completes. Deterministic, so runs
+//           can be diffed against each other. Overdrawn counts the pixels the
+//           case wrote more than once, it must stay 0.
+// lookup:   host nanoseconds per font_gliph() call for every character of
+//           the font, next to a walk of the glyphs in storage order (the
+//           linked list font_gliph() used to follow).
+// blend:    host nanoseconds to colorize one glyph with _mix_colors() per
+//           pixel versus decoding it through the per-command alpha LUT.
+// font:     compressed size of every glyph and host nanoseconds to decode it
+//           into the DMA buffer.
+// text_field: a 6-cell temperature readout stepping through values, every
+//           update as a text field versus as a full DRAW_TEXT.
+// gliph_cache: a 6-cell readout stepping through values as full DRAW_TEXT
+//           commands, in passes over the same values from a cold glyph
+//           cache. Every hit is a glyph the CPU did not blend. The first
+//           pass empties the cache before every update, the glyphs must go
+//           out in as many windows with the cache as without it.
+// ring:     record size and host nanoseconds per enqueue for every command,
+//           then a stream of mixed commands that wraps the ring many times.
+// compositor: a status screen refreshed the way a simple UI loop does it,
+//           with the compositor bypassed and enabled.
+// list:     the compositor status screen as separate calls, with the display
+//           task woken after every call or once per screen, and as one
+//           display list.
+// bands:    scenes drawn in direct and in band render mode, the panel must
+//           end up the same in both. The clipped scene draws across a clip
+//           and past the panel edges.
+// shapes:   a round rect, disks, a ring and arcs drawn one by one: bus bytes
+//           next to a window over the bounding box, windows, the pixels the
+//           coverage reaches (each written once) and simulated time. Host
+//           microseconds to rasterize every row stand in for the CPU cycles
+//           of the coverage, which the simulator does not count.
+// images:   test images in every indexed format and RGB565, and the icons
+//           as alpha images: flash bytes, bus bytes, windows and simulated
+//           time drawn whole, cut by a clip and drawn again unchanged. The
+//           panel must match a plain decode of the image.
+// chart:    bus bytes per sample of a strip chart that scrolls in hardware,
+//           versus repainting the plot for every sample.
+// power:    30 s of a static screen with a 10 Hz readout in the status strip
+//           and one input at 20 s, with power management off and on.
+// vsync:    page flips (a full screen fill and a panel over it) with the
+//           windows written as they come, behind the scan timed from TE and
+//           from the timer right after SLPOUT and seconds later. Counts the
+//           refreshes that tore.
+// window:   simulated microseconds to open a window (CASET/RASET/RAMWR) when
+//           the columns change and when only the rows do, and for a one
+//           pixel fill from the call to the end of the transaction. CPU time
+//           leaves out what the task spends blocked.
+// policy:   a screen clear followed by a burst of readout updates larger than
+//           the ring, under each full-ring policy, then a fence wait for the
+//           last update.
+
+typedef struct {
+    const char *name;
+    const char *command;
+    void (*run)(void);
+} sim_bench_case_t;
+
+////////////////////////////////////////////////////////////////////////////////// COMMANDS ///
+
+static void sim_bench_fill_screen(void) {
+    display_fill_screen(COLOR_BLUE);
+}
+
+static void sim_bench_fill_rect_strip(void) {
+    display_fill_rect(COLOR_BLUE, 0, DISPLAY_WIDTH - 1, 0, 63);
+}
+
+static void sim_bench_fill_rect_cell(void) {
+    display_fill_rect(COLOR_BLUE, 0, fira_code.width - 1, 0, fira_code.height - 1);
+}
+
+static void sim_bench_fill_rect_pixel(void) {
+    display_fill_rect(COLOR_BLUE, 10, 10, 10, 10);
+}
+
+static void sim_bench_draw_rect_panel(void) {
+    display_draw_rect(COLOR_BLACK, COLOR_WHITE, 10, 129, 10, 73, 1);
+}
+
+static void sim_bench_draw_rect_frame(void) {
+    display_draw_rect(COLOR_BLACK, COLOR_WHITE, 10, 129, 10, 73, 4);
+}
+
+// Sides thicker than half of it meet, nothing is left inside
+static void sim_bench_draw_rect_solid(void) {
+    display_draw_rect(COLOR_BLACK, COLOR_WHITE, 10, 14, 10, 73, 3);
+}
+
+static void sim_bench_draw_text_digit(void) {
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, L"8");
+}
+
+static void sim_bench_draw_text_readout(void) {
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, L"123.4°");
+}
+
+static void sim_bench_draw_text_line(void) {
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, L"Hellow");
+}
+
+static void sim_bench_fill_rect_offscreen(void) {
+    display_fill_rect(COLOR_BLUE, DISPLAY_WIDTH, DISPLAY_WIDTH + 99, 0, 63);
+}
+
+static void sim_bench_draw_text_cut(void) {
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, DISPLAY_WIDTH - 54, 0, L"Hellow");
+}
+
+static const sim_bench_case_t sim_bench_commands[] = {
+    { "fill_screen",        "FILL_SCREEN",  sim_bench_fill_screen       },
+    { "fill_rect_240x64",   "FILL_RECT",    sim_bench_fill_rect_strip   },
+    { "fill_rect_36x64",    "FILL_RECT",    sim_bench_fill_rect_cell    },
+    { "fill_rect_1x1",      "FILL_RECT",    sim_bench_fill_rect_pixel   },
+    { "draw_rect_120x64",   "DRAW_RECT",    sim_bench_draw_rect_panel   },
+    { "draw_rect_120x64_b4","DRAW_RECT",    sim_bench_draw_rect_frame   },
+    { "draw_rect_5x64_b3",  "DRAW_RECT",    sim_bench_draw_rect_solid   },
+    { "draw_text_1",        "DRAW_TEXT",    sim_bench_draw_text_digit   },
+    { "draw_text_6_readout","DRAW_TEXT",    sim_bench_draw_text_readout },
+    { "draw_text_6_line",   "DRAW_TEXT",    sim_bench_draw_text_line    },
+    { "fill_rect_offscreen","FILL_RECT",    sim_bench_fill_rect_offscreen },
+    { "draw_text_cut_54",   "DRAW_TEXT",    sim_bench_draw_text_cut     },
+};
+
+//////////////////////////////////////////////////////////////////////////////////// LOOKUP ///
+
+#define SIM_BENCH_LOOKUPS 1000000
+
+static volatile uintptr_t sim_bench_sink;
+
+static uint64_t sim_bench_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+typedef struct {
+    wchar_t key;
+    const uint8_t *data;
+} sim_bench_gliph_t;
+
+static int sim_bench_by_data(const void *a, const void *b) {
+    const sim_bench_gliph_t *x = a;
+    const sim_bench_gliph_t *y = b;
+    return (x->data > y->data) - (x->data < y->data);
+}
+
+static const uint8_t *sim_bench_list_lookup(const sim_bench_gliph_t *list, size_t count, wchar_t ch) {
+    for (size_t i = 0; i < count; i++) {
+        if (list[i].key == ch) return list[i].data;
+    }
+    return NULL;
+}
+
+static void sim_bench_lookup(const font_t *font) {
+    static sim_bench_gliph_t list[FONT_ASCII_LAST - FONT_ASCII_FIRST + 1 + 64];
+    size_t count = 0;
+
+    for (wchar_t ch = FONT_ASCII_FIRST; ch <= FONT_ASCII_LAST; ch++) {
+        const uint8_t *data = font->ascii[ch - FONT_ASCII_FIRST];
+        if (data != NULL) list[count++] = (sim_bench_gliph_t) { .key = ch, .data = data };
+    }
+    for (size_t i = 0; i < font->gliph_count && count < sizeof(list) / sizeof(list[0]); i++) {
+        list[count++] = (sim_bench_gliph_t) { .key = font->gliph[i].key, .data = font->gliph[i].data };
+    }
+    qsort(list, count, sizeof(list[0]), sim_bench_by_data);
+
+    printf("# suite=lookup\n");
+    printf("code,ns_table,ns_list\n");
+    for (size_t i = 0; i <= count; i++) {
+        // One extra round for a character the font does not have
+        wchar_t ch = i < count ? list[i].key : L'\u4E00';
+        const font_t * volatile target = font;
+
+        uint64_t start = sim_bench_now_ns();
+        for (size_t n = 0; n < SIM_BENCH_LOOKUPS; n++) {
+            sim_bench_sink += (uintptr_t) font_gliph(target, ch);
+        }
+        uint64_t table = sim_bench_now_ns() - start;
+
+        start = sim_bench_now_ns();
+        for (size_t n = 0; n < SIM_BENCH_LOOKUPS; n++) {
+            const sim_bench_gliph_t * volatile walk = list;
+            sim_bench_sink += (uintptr_t) sim_bench_list_lookup(walk, count, ch);
+        }
+        uint64_t linked = sim_bench_now_ns() - start;
+
+        printf("0x%04x,%.2f,%.2f\n", (unsigned) ch, (double) table / SIM_BENCH_LOOKUPS, (double) linked / SIM_BENCH_LOOKUPS);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////// BLEND ///
+
+#define SIM_BENCH_GLYPHS 2000
+
+static void sim_bench_blend(const font_t *font, const wchar_t *text, uint16_t fore_color, uint16_t back_color) {
+    static uint8_t alpha[FONT_MAX_GLIPH_SIZE];
+    static uint16_t reference[FONT_MAX_GLIPH_SIZE];
+    size_t size = font->width * font->height;
+
+    for (; *text; text++) {
+        const uint8_t *data = font_gliph(font, *text);
+        font_gliph_alpha(font, data, alpha);
+
+        uint64_t start = sim_bench_now_ns();
+        for (size_t n = 0; n < SIM_BENCH_GLYPHS; n++) {
+            for (size_t j = 0; j < size; j++) reference[j] = _mix_colors(fore_color, back_color, alpha[j]);
+            sim_bench_sink += reference[n % size];
+        }
+        uint64_t mix = sim_bench_now_ns() - start;
+
+        // Alternate the background so every round really rebuilds the table
+        start = sim_bench_now_ns();
+        for (size_t n = 0; n < SIM_BENCH_GLYPHS; n++) {
+            _display_build_alpha_lut(fore_color, back_color ^ (n & 1));
+            sim_bench_sink += display_alpha_lut[n & FONT_ALPHA_MAX];
+        }
+        uint64_t build = sim_bench_now_ns() - start;
+
+        _display_build_alpha_lut(fore_color, back_color);
+        start = sim_bench_now_ns();
+        for (size_t n = 0; n < SIM_BENCH_GLYPHS; n++) {
+            gliph_decoder_t decoder;
+            _display_gliph_decoder_init(&decoder, data);
+            _display_render_text_strip(display_dma_buffer[0], font, &decoder, 1, 0, font->height, back_color);
+            sim_bench_sink += display_dma_buffer[0][n % size];
+        }
+        uint64_t decode = sim_bench_now_ns() - start;
+
+        bool match = memcmp(reference, display_dma_buffer[0], size * sizeof(uint16_t)) == 0;
+        printf("0x%04x,0x%04x,0x%04x,%.1f,%.1f,%.1f,%d\n",
+            (unsigned) *text, fore_color, back_color,
+            (double) mix / SIM_BENCH_GLYPHS,
+            (double) build / SIM_BENCH_GLYPHS,
+            (double) decode / SIM_BENCH_GLYPHS,
+            match
+        );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////// FONT ///
+
+static void sim_bench_font_gliph(const font_t *font, wchar_t ch, const uint8_t *data, size_t *packed_total, size_t *ink_total, uint64_t *ns_total) {
+    size_t size = font->width * font->height;
+    gliph_decoder_t decoder;
+
+    _display_gliph_decoder_init(&decoder, data);
+    _display_render_text_strip(display_dma_buffer[0], font, &decoder, 1, 0, font->height, COLOR_BLACK);
+    size_t packed = decoder.data - data;
+    size_t ink = decoder.box.width * decoder.box.height;
+
+    uint64_t start = sim_bench_now_ns();
+    for (size_t n = 0; n < SIM_BENCH_GLYPHS; n++) {
+        _display_gliph_decoder_init(&decoder, data);
+        _display_render_text_strip(display_dma_buffer[0], font, &decoder, 1, 0, font->height, COLOR_BLACK);
+        sim_bench_sink += display_dma_buffer[0][n % size];
+    }
+    uint64_t ns = (sim_bench_now_ns() - start) / SIM_BENCH_GLYPHS;
+
+    printf("0x%04x,%ux%u,%zu,%zu,%zu,%.1f,%llu\n",
+        (unsigned) ch, decoder.box.width, decoder.box.height, ink, packed, size, (double) size / packed, (unsigned long long) ns);
+    *packed_total += packed;
+    *ink_total += ink;
+    *ns_total += ns;
+}
+
+static void sim_bench_font(const font_t *font) {
+    size_t packed = 0;
+    size_t ink = 0;
+    size_t count = 0;
+    uint64_t ns = 0;
+
+    _display_build_alpha_lut(COLOR_WHITE, COLOR_BLACK);
+
+    printf("# suite=font\n");
+    printf("code,ink_box,ink_pixels,bytes,bytes_8bit,ratio,ns_decode\n");
+    for (wchar_t ch = FONT_ASCII_FIRST; ch <= FONT_ASCII_LAST; ch++) {
+        const uint8_t *data = font->ascii[ch - FONT_ASCII_FIRST];
+        if (data == NULL) continue;
+        sim_bench_font_gliph(font, ch, data, &packed, &ink, &ns);
+        count++;
+    }
+    for (size_t i = 0; i < font->gliph_count; i++) {
+        sim_bench_font_gliph(font, font->gliph[i].key, font->gliph[i].data, &packed, &ink, &ns);
+        count++;
+    }
+
+    size_t raw = count * font->width * font->height;
+    printf("total,,%zu,%zu,%zu,%.1f,%llu\n", ink, packed, raw, (double) raw / packed, (unsigned long long) (ns / count));
+}
+
+//////////////////////////////////////////////////////////////////////////////// COMPOSITOR ///
+
+#define SIM_BENCH_FRAMES 32
+
+// Every refresh repaints the whole screen: static labels, a bar built from two
+// fills and a readout that is cleared before it is drawn. The value changes
+// on every fourth refresh only.
+static void sim_bench_status_screen(size_t frame) {
+    static wchar_t *values[] = { L"123.4°", L"123.5°", L"123.7°", L"124.0°" };
+
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, L"Temp");
+    display_fill_rect(COLOR_BLACK, 0, 6 * fira_code.width - 1, 64, 127);
+    display_draw_text(&fira_code, COLOR_RED, COLOR_BLACK, 0, 64, values[(frame / 4) % 4]);
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 160, L"Fan");
+    display_fill_rect(COLOR_GREEN, 0, DISPLAY_WIDTH - 1, 300, 309);
+    display_fill_rect(COLOR_GREEN, 0, DISPLAY_WIDTH - 1, 310, 319);
+    sim_display_pump();
+}
+
+static void sim_bench_compositor(const char *name, bool bypass) {
+    display_compositor_bypass = bypass;
+    _display_compositor_reset();
+    display_fill_screen(COLOR_BLACK);
+    sim_display_pump();
+
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    memset(&display_stats, 0, sizeof(display_stats));
+    uint64_t start_ps = sim_time_ps;
+
+    for (size_t frame = 0; frame < SIM_BENCH_FRAMES; frame++) sim_bench_status_screen(frame);
+
+    printf("%s,%d,%lu,%lu,%lu,%lu,%lu,%lu,%llu,%llu,%.3f,%llu\n",
+        name,
+        SIM_BENCH_FRAMES,
+        (unsigned long) display_stats.commands,
+        (unsigned long) display_stats.commands_dropped,
+        (unsigned long) display_stats.commands_merged,
+        (unsigned long) display_stats.pixels_submitted,
+        (unsigned long) display_stats.pixels_drawn,
+        (unsigned long) (display_stats.pixels_submitted - display_stats.pixels_drawn),
+        (unsigned long long) sim_stats.spi_bytes,
+        (unsigned long long) sim_stats.windows,
+        (double) (sim_time_ps - start_ps) / 1e6,
+        (unsigned long long) sim_stats.protocol_errors
+    );
+    display_compositor_bypass = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////// TEXT FIELD ///
+
+static uint64_t sim_bench_spi_bytes(void (*draw)(const wchar_t *), const wchar_t *value) {
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    _display_compositor_reset();
+    draw(value);
+    sim_display_pump();
+    return sim_stats.spi_bytes;
+}
+
+static display_text_field_t sim_bench_field;
+static size_t sim_bench_cells;
+
+static void sim_bench_draw_field(const wchar_t *value) {
+    sim_bench_cells = display_text_field_set(&sim_bench_field, COLOR_WHITE, COLOR_BLACK, value);
+}
+
+static void sim_bench_draw_full(const wchar_t *value) {
+    wchar_t text[DISPLAY_TEXT_FIELD_CELLS + 1];
+    wcsncpy(text, value, DISPLAY_TEXT_FIELD_CELLS);
+    text[DISPLAY_TEXT_FIELD_CELLS] = 0;
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, text);
+}
+
+static void sim_bench_text_field(void) {
+    static const wchar_t *values[] = { L"123.4°", L"123.5°", L"123.7°", L"123.8°", L"123.8°", L"123.9°", L"124.0°", L"124.1°", L"124.3°" };
+    const size_t count = sizeof(values) / sizeof(values[0]);
+    uint64_t full[sizeof(values) / sizeof(values[0])];
+    uint64_t field_total = 0;
+    uint64_t full_total = 0;
+
+    for (size_t i = 0; i < count; i++) full[i] = sim_bench_spi_bytes(sim_bench_draw_full, values[i]);
+
+    display_text_field_init(&sim_bench_field, &fira_code, 0, 0, 6);
+
+    printf("# suite=text_field\n");
+    printf("update,cells_sent,spi_bytes_field,spi_bytes_full,saved_percent\n");
+    for (size_t i = 0; i < count; i++) {
+        uint64_t field = sim_bench_spi_bytes(sim_bench_draw_field, values[i]);
+
+        // The first update has no previous state to compare against
+        if (i > 0) {
+            field_total += field;
+            full_total  += full[i];
+        }
+        printf("%zu,%zu,%llu,%llu,%.1f\n", i, sim_bench_cells, (unsigned long long) field, (unsigned long long) full[i], 100.0 * (1.0 - (double) field / (double) full[i]));
+    }
+    printf("total,,%llu,%llu,%.1f\n", (unsigned long long) field_total, (unsigned long long) full_total, 100.0 * (1.0 - (double) field_total / (double) full_total));
+}
+
+////////////////////////////////////////////////////////////////////////////////////// RING ///
+
+#define SIM_BENCH_ENQUEUES 100000
+
+static void sim_bench_enqueue_fill_screen(void) {
+    display_fill_screen(COLOR_BLUE);
+}
+
+static void sim_bench_enqueue_fill_rect(void) {
+    display_fill_rect(COLOR_BLUE, 0, 35, 0, 63);
+}
+
+static void sim_bench_enqueue_draw_text(void) {
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, L"123.4°");
+}
+
+static void sim_bench_enqueue_draw_text_long(void) {
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, L"Heater 1: 123.4° / 250.0°, fan 75%");
+}
+
+static const struct {
+    const char *name;
+    size_t size;
+    void (*run)(void);
+} sim_bench_enqueues[] = {
+    { "fill_screen",    DISPLAY_RECORD_SIZE(fill_screen),                           sim_bench_enqueue_fill_screen       },
+    { "fill_rect",      DISPLAY_RECORD_SIZE(fill_rect),                             sim_bench_enqueue_fill_rect         },
+    { "draw_text_6",    DISPLAY_RECORD_SIZE(draw_text) + 6 * sizeof(wchar_t),       sim_bench_enqueue_draw_text         },
+    { "draw_text_34",   DISPLAY_RECORD_SIZE(draw_text) + 34 * sizeof(wchar_t),      sim_bench_enqueue_draw_text_long    },
+};
+
+// Drop everything in the ring without drawing it
+static void sim_bench_ring_discard(void) {
+    size_t position = display_ring_tail;
+    while (_display_ring_peek(&position, SIZE_MAX) != NULL);
+    _display_ring_release(position);
+}
+
+static void sim_bench_ring(void) {
+    printf("# suite=ring\n");
+    printf("command,record_bytes,ns_enqueue\n");
+
+    // Rounds of commands that fit the ring, discarded between the rounds and
+    // outside of the measured time
+    for (size_t i = 0; i < sizeof(sim_bench_enqueues) / sizeof(sim_bench_enqueues[0]); i++) {
+        size_t round = DISPLAY_RING_SIZE / 2 / sim_bench_enqueues[i].size;
+        size_t rounds = SIM_BENCH_ENQUEUES / round;
+        uint64_t total = 0;
+
+        for (size_t n = 0; n < rounds; n++) {
+            uint64_t start = sim_bench_now_ns();
+            for (size_t j = 0; j < round; j++) sim_bench_enqueues[i].run();
+            total += sim_bench_now_ns() - start;
+            sim_bench_ring_discard();
+        }
+
+        printf("%s,%zu,%.1f\n", sim_bench_enqueues[i].name, sim_bench_enqueues[i].size, (double) total / (rounds * round));
+    }
+
+    // Enqueue without draining: the ring fills up, wraps and producers wait
+    // for the display task
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    memset(&display_stats, 0, sizeof(display_stats));
+    _display_compositor_reset();
+    for (size_t n = 0; n < 200; n++) {
+        display_fill_rect(n, 0, 35, 0, 63);
+        display_draw_text(&fira_code, COLOR_WHITE, n, 0, 64, (n & 1) ? L"1" : L"123.4°");
+    }
+    sim_display_pump();
+    printf("wrap,%lu commands,%llu protocol errors\n", (unsigned long) display_stats.commands, (unsigned long long) sim_stats.protocol_errors);
+}
+
+////////////////////////////////////////////////////////////////////////////// DISPLAY LIST ///
+
+typedef enum {
+    SIM_BENCH_WAKE_EACH,
+    SIM_BENCH_WAKE_ONCE,
+    SIM_BENCH_LIST,
+} sim_bench_submit_t;
+
+static display_list_t sim_bench_screen;
+
+// Display task batches, each one leaves an intermediate state on the panel
+static size_t sim_bench_batches;
+
+static void sim_bench_wake_display(void) {
+    while (_display_compose()) sim_bench_batches++;
+}
+
+// Same screen as sim_bench_status_screen()
+static void sim_bench_status_calls(size_t frame, bool wake) {
+    static wchar_t *values[] = { L"123.4°", L"123.5°", L"123.7°", L"124.0°" };
+
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, L"Temp");
+    if (wake) sim_bench_wake_display();
+    display_fill_rect(COLOR_BLACK, 0, 6 * fira_code.width - 1, 64, 127);
+    if (wake) sim_bench_wake_display();
+    display_draw_text(&fira_code, COLOR_RED, COLOR_BLACK, 0, 64, values[(frame / 4) % 4]);
+    if (wake) sim_bench_wake_display();
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 160, L"Fan");
+    if (wake) sim_bench_wake_display();
+    display_fill_rect(COLOR_GREEN, 0, DISPLAY_WIDTH - 1, 300, 309);
+    if (wake) sim_bench_wake_display();
+    display_fill_rect(COLOR_GREEN, 0, DISPLAY_WIDTH - 1, 310, 319);
+    sim_bench_wake_display();
+}
+
+static void sim_bench_status_list(size_t frame) {
+    static const wchar_t *values[] = { L"123.4°", L"123.5°", L"123.7°", L"124.0°" };
+
+    display_list_begin(&sim_bench_screen);
+    display_list_draw_text(&sim_bench_screen, &fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, L"Temp");
+    display_list_fill_rect(&sim_bench_screen, COLOR_BLACK, 0, 6 * fira_code.width - 1, 64, 127);
+    display_list_draw_text(&sim_bench_screen, &fira_code, COLOR_RED, COLOR_BLACK, 0, 64, values[(frame / 4) % 4]);
+    display_list_draw_text(&sim_bench_screen, &fira_code, COLOR_WHITE, COLOR_BLACK, 0, 160, L"Fan");
+    display_list_fill_rect(&sim_bench_screen, COLOR_GREEN, 0, DISPLAY_WIDTH - 1, 300, 309);
+    display_list_fill_rect(&sim_bench_screen, COLOR_GREEN, 0, DISPLAY_WIDTH - 1, 310, 319);
+    display_list_submit(&sim_bench_screen);
+    sim_bench_wake_display();
+}
+
+static void sim_bench_list(const char *name, sim_bench_submit_t mode) {
+    _display_compositor_reset();
+    display_fill_screen(COLOR_BLACK);
+    sim_display_pump();
+
+    // Commits are counted as fences, between the two fills around the frames
+    display_fence_t first = display_fill_screen(COLOR_BLACK);
+    sim_display_pump();
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    memset(&display_stats, 0, sizeof(display_stats));
+    sim_bench_batches = 0;
+    uint64_t start_ps = sim_time_ps;
+
+    for (size_t frame = 0; frame < SIM_BENCH_FRAMES; frame++) {
+        if (mode == SIM_BENCH_LIST) {
+            sim_bench_status_list(frame);
+        } else {
+            sim_bench_status_calls(frame, mode == SIM_BENCH_WAKE_EACH);
+        }
+    }
+    sim_wait_event(UINT64_MAX);
+    display_fence_t last = display_fill_screen(COLOR_BLACK);
+
+    printf("%s,%d,%lu,%zu,%lu,%lu,%lu,%llu,%.3f\n",
+        name,
+        SIM_BENCH_FRAMES,
+        (unsigned long) (last - first - 1),
+        sim_bench_batches,
+        (unsigned long) display_stats.commands,
+        (unsigned long) display_stats.commands_dropped,
+        (unsigned long) display_stats.commands_merged,
+        (unsigned long long) sim_stats.spi_bytes,
+        (double) (sim_time_ps - start_ps) / 1e6
+    );
+    sim_display_pump();
+}
+
+/////////////////////////////////////////////////////////////////////////////////// BANDS ///
+
+static uint64_t sim_bench_framebuffer_hash(void) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t y = 0; y < SIM_PANEL_HEIGHT; y++) {
+        for (size_t x = 0; x < SIM_PANEL_WIDTH; x++) hash = (hash ^ sim_framebuffer[y][x]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Overlapping primitives in one batch: text cut by fills from every side, a
+// frame, an arc over a fill, an icon, text running off the right edge and
+// fills that join into one window
+static void sim_bench_overlap_screen(size_t frame) {
+    uint16_t shift = frame * 7;
+
+    display_list_begin(&sim_bench_screen);
+    display_list_fill_rect(&sim_bench_screen, COLOR_BLUE, 0, DISPLAY_WIDTH - 1, 0, 199);
+    display_list_draw_text(&sim_bench_screen, &fira_code, COLOR_WHITE, COLOR_BLACK, 10 + shift, 20, L"W8.g");
+    display_list_fill_rect(&sim_bench_screen, COLOR_RED, 30 + shift, 70 + shift, 10, 40);
+    display_list_fill_rect(&sim_bench_screen, COLOR_GREEN, 0, 20 + shift, 60, 90);
+    display_list_draw_arc(&sim_bench_screen, COLOR_RED, COLOR_BLUE, 40, 100, 30, 6, 45, 315);
+    display_list_draw_image(&sim_bench_screen, &icon_fan, COLOR_WHITE, COLOR_BLUE, 180 - shift, 60);
+    display_list_draw_rect(&sim_bench_screen, COLOR_BLACK, COLOR_WHITE, 100, 200, 120, 180, 1);
+    display_list_draw_text(&sim_bench_screen, &fira_code, COLOR_RED, COLOR_WHITE, 150 + shift, 130, L"%&");
+    display_list_fill_rect(&sim_bench_screen, COLOR_GREEN, 0, 119, 250, 259);
+    display_list_fill_rect(&sim_bench_screen, COLOR_GREEN, 120, DISPLAY_WIDTH - 1, 250, 259);
+    display_list_draw_text(&sim_bench_screen, &fira_code, COLOR_WHITE, COLOR_BLUE, 5, 256, L"Jy");
+    display_list_submit(&sim_bench_screen);
+    sim_display_pump();
+}
+
+// A window with a clip: everything drawn in it crosses the clip or the panel
+static void sim_bench_clipped_screen(size_t frame) {
+    uint16_t shift = (frame * 5) % 100;
+
+    display_list_begin(&sim_bench_screen);
+    display_list_set_clip(&sim_bench_screen, 20, 199, 40 + shift, 179);
+    display_list_fill_screen(&sim_bench_screen, COLOR_BLUE);
+    display_list_draw_text(&sim_bench_screen, &fira_code, COLOR_WHITE, COLOR_BLACK, 2, 30, L"W8.g%&");
+    display_list_fill_rect(&sim_bench_screen, COLOR_RED, 150, 400, 100, 120);
+    display_list_draw_rect(&sim_bench_screen, COLOR_BLACK, COLOR_WHITE, 180, 300, 150, 250, 3);
+    display_list_set_clip(&sim_bench_screen, 0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1);
+    display_list_draw_text(&sim_bench_screen, &fira_code, COLOR_RED, COLOR_WHITE, DISPLAY_WIDTH - 40, 280, L"Jy");
+    display_list_submit(&sim_bench_screen);
+    sim_display_pump();
+}
+
+static uint64_t sim_bench_bands(const char *scene, void (*draw)(size_t), const char *name, display_render_mode_t mode, uint64_t expected) {
+    display_set_render_mode(mode);
+    _display_compositor_reset();
+    display_fill_screen(COLOR_BLACK);
+    sim_display_pump();
+
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    memset(&display_stats, 0, sizeof(display_stats));
+    uint64_t start_ps = sim_time_ps;
+
+    for (size_t frame = 0; frame < SIM_BENCH_FRAMES; frame++) draw(frame);
+
+    uint64_t hash = sim_bench_framebuffer_hash();
+    printf("%s,%s,%d,%lu,%llu,%llu,%llu,%.3f,%llu,%d\n",
+        scene,
+        name,
+        SIM_BENCH_FRAMES,
+        (unsigned long) (display_stats.commands - display_stats.commands_dropped - display_stats.commands_merged),
+        (unsigned long long) sim_stats.windows,
+        (unsigned long long) sim_stats.spi_bytes,
+        (unsigned long long) sim_stats.dma_items_fixed,
+        (double) (sim_time_ps - start_ps) / 1e6,
+        (unsigned long long) sim_stats.protocol_errors,
+        expected == 0 || hash == expected
+    );
+
+    display_set_render_mode(DISPLAY_RENDER_MODE);
+    return hash;
+}
+
+//////////////////////////////////////////////////////////////////////////////////// SHAPES ///
+
+#define SIM_BENCH_RASTERS 100
+
+typedef struct {
+    const char *name;
+    display_command_t command;
+} sim_bench_shape_t;
+
+static const sim_bench_shape_t sim_bench_shapes[] = {
+    { "round_rect_120x64_r12", { .id = DISPLAY_COMMAND_ROUND_RECT, .round_rect = { COLOR_WHITE, COLOR_BLUE, 10, 129, 10, 73, 12 } } },
+    { "round_rect_120x64_r32", { .id = DISPLAY_COMMAND_ROUND_RECT, .round_rect = { COLOR_WHITE, COLOR_BLUE, 10, 129, 10, 73, 32 } } },
+    { "circle_r8",             { .id = DISPLAY_COMMAND_DRAW_ARC,   .draw_arc   = { COLOR_WHITE, COLOR_BLUE, 120, 160, 8, 9, 0, 360 } } },
+    { "circle_r40",            { .id = DISPLAY_COMMAND_DRAW_ARC,   .draw_arc   = { COLOR_WHITE, COLOR_BLUE, 120, 160, 40, 41, 0, 360 } } },
+    { "ring_r60_t8",           { .id = DISPLAY_COMMAND_DRAW_ARC,   .draw_arc   = { COLOR_WHITE, COLOR_BLUE, 120, 160, 60, 8, 0, 360 } } },
+    { "arc_r60_t8_270",        { .id = DISPLAY_COMMAND_DRAW_ARC,   .draw_arc   = { COLOR_WHITE, COLOR_BLUE, 120, 160, 60, 8, 225, 495 } } },
+    { "arc_r60_t8_90",         { .id = DISPLAY_COMMAND_DRAW_ARC,   .draw_arc   = { COLOR_WHITE, COLOR_BLUE, 120, 160, 60, 8, 0, 90 } } },
+    { "circle_r40_cut",        { .id = DISPLAY_COMMAND_DRAW_ARC,   .draw_arc   = { COLOR_WHITE, COLOR_BLUE, 10, 20, 40, 41, 0, 360 } } },
+};
+
+static void sim_bench_shape_submit(const display_command_t *command) {
+    if (command->id == DISPLAY_COMMAND_ROUND_RECT) {
+        const round_rect_t *rect = &command->round_rect;
+        display_fill_round_rect(rect->color, rect->back_color, rect->left, rect->right, rect->top, rect->bottom, rect->radius);
+    } else {
+        const draw_arc_t *arc = &command->draw_arc;
+        display_draw_arc(arc->color, arc->back_color, arc->x, arc->y, arc->radius, arc->thickness, arc->start, arc->end);
+    }
+}
+
+// Pixels the coverage reaches, and host time to rasterize every row once
+static uint64_t sim_bench_shape_raster(const display_command_t *command, const display_rect_t *rect, uint64_t *ns) {
+    static uint8_t alpha[DISPLAY_WIDTH];
+    uint64_t covered = 0;
+
+    uint64_t start = sim_bench_now_ns();
+    for (size_t n = 0; n < SIM_BENCH_RASTERS; n++) {
+        for (size_t y = rect->top; y <= rect->bottom; y++) {
+            _display_shape_alpha(command, y, rect->left, rect->right, alpha);
+            sim_bench_sink += alpha[n % (rect->right - rect->left + 1)];
+            if (n > 0) continue;
+            for (size_t x = 0; x <= (size_t) (rect->right - rect->left); x++) covered += alpha[x] != 0;
+        }
+    }
+    *ns = (sim_bench_now_ns() - start) / SIM_BENCH_RASTERS;
+    return covered;
+}
+
+// Every case is drawn on its own over a cleared panel. Box bytes is what the
+// bounding box would cost as one window, covered is checked against the
+// pixels written.
+static void sim_bench_shapes_suite(void) {
+    printf("# suite=shapes\n");
+    printf("case,spi_bytes,box_bytes,windows,pixels,covered,overdrawn,time_us,cpu_us,raster_us_host\n");
+
+    for (size_t i = 0; i < sizeof(sim_bench_shapes) / sizeof(sim_bench_shapes[0]); i++) {
+        const sim_bench_shape_t *bench = &sim_bench_shapes[i];
+        display_rect_t rect;
+        uint64_t ns;
+
+        display_fill_screen(COLOR_BLUE);
+        sim_display_pump();
+        sim_wait_event(UINT64_MAX);
+        sim_reset_stats();
+        _display_compositor_reset();
+        uint64_t start = sim_time_ps;
+
+        sim_bench_shape_submit(&bench->command);
+        sim_display_pump();
+
+        uint64_t elapsed = sim_time_ps - start;
+        uint64_t cpu = elapsed - sim_stats.task_wait_ps + sim_stats.isr_ps;
+        _display_command_rect(&bench->command, &rect);
+        uint64_t covered = sim_bench_shape_raster(&bench->command, &rect, &ns);
+
+        printf("%s,%llu,%llu,%llu,%llu,%llu,%llu,%.1f,%.1f,%.1f\n",
+            bench->name,
+            (unsigned long long) sim_stats.spi_bytes,
+            (unsigned long long) (rect.right - rect.left + 1) * (rect.bottom - rect.top + 1) * 2,
+            (unsigned long long) sim_stats.windows,
+            (unsigned long long) sim_stats.pixels_written,
+            (unsigned long long) covered,
+            (unsigned long long) sim_stats.pixels_overdrawn,
+            (double) elapsed / 1e6,
+            (double) cpu / 1e6,
+            (double) ns / 1e3
+        );
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////// IMAGES ///
+
+#define SIM_BENCH_IMAGE_WIDTH   48
+#define SIM_BENCH_IMAGE_HEIGHT  40
+
+static uint16_t sim_bench_image_palette[256];
+static uint8_t sim_bench_image_data[4][SIM_BENCH_IMAGE_WIDTH * SIM_BENCH_IMAGE_HEIGHT];
+static uint16_t sim_bench_image_pixels[SIM_BENCH_IMAGE_WIDTH * SIM_BENCH_IMAGE_HEIGHT];
+
+#define SIM_BENCH_INDEXED(bits) { .width = SIM_BENCH_IMAGE_WIDTH, .height = SIM_BENCH_IMAGE_HEIGHT, .format = IMAGE_FORMAT_INDEX##bits, \
+    .colors = 1 << bits, .palette = sim_bench_image_palette, .data = sim_bench_image_data[IMAGE_FORMAT_INDEX##bits] }
+
+static const image_t sim_bench_images[] = {
+    SIM_BENCH_INDEXED(1),
+    SIM_BENCH_INDEXED(2),
+    SIM_BENCH_INDEXED(4),
+    SIM_BENCH_INDEXED(8),
+    { .width = SIM_BENCH_IMAGE_WIDTH, .height = SIM_BENCH_IMAGE_HEIGHT, .format = IMAGE_FORMAT_RGB565, .data = (const uint8_t *) sim_bench_image_pixels },
+};
+
+static const char * const sim_bench_image_formats[] = { "index1", "index2", "index4", "index8", "rgb565", "alpha" };
+
+// Diagonal stripes through every palette entry, a gradient for RGB565
+static void sim_bench_image_setup(void) {
+    for (size_t i = 0; i < 256; i++) sim_bench_image_palette[i] = (uint16_t) (i * 0x0101 * 37);
+
+    for (size_t format = IMAGE_FORMAT_INDEX1; format <= IMAGE_FORMAT_INDEX8; format++) {
+        size_t bits = IMAGE_INDEX_BITS(format);
+        size_t stride = (SIM_BENCH_IMAGE_WIDTH * bits + 7) / 8;
+        memset(sim_bench_image_data[format], 0, sizeof(sim_bench_image_data[format]));
+        for (size_t y = 0; y < SIM_BENCH_IMAGE_HEIGHT; y++) {
+            for (size_t x = 0; x < SIM_BENCH_IMAGE_WIDTH; x++) {
+                size_t index = (x + 3 * y) % (1u << bits);
+                sim_bench_image_data[format][y * stride + x * bits / 8] |= index << (8 - bits - (x * bits) % 8);
+            }
+        }
+    }
+    for (size_t y = 0; y < SIM_BENCH_IMAGE_HEIGHT; y++) {
+        for (size_t x = 0; x < SIM_BENCH_IMAGE_WIDTH; x++) sim_bench_image_pixels[y * SIM_BENCH_IMAGE_WIDTH + x] = (x << 11) | (y << 5) | (x ^ y);
+    }
+}
+
+// Flash the image takes, an alpha image is walked token by token
+static size_t sim_bench_image_bytes(const image_t *image) {
+    if (image->format == IMAGE_FORMAT_RGB565) return image->width * image->height * sizeof(uint16_t);
+    if (image->format != IMAGE_FORMAT_ALPHA) return (image->width * IMAGE_INDEX_BITS(image->format) + 7) / 8 * image->height + image->colors * sizeof(uint16_t);
+
+    const gliph_box_t *box = (const gliph_box_t *) image->data;
+    const uint8_t *data = image->data + sizeof(gliph_box_t);
+    for (size_t size = box->width * box->height; size > 0; ) {
+        uint8_t token = *data++;
+        bool literal = token & FONT_TOKEN_LITERAL;
+        size_t count = min((size_t) (token & (literal ? FONT_LITERAL_MASK : FONT_RUN_MASK)) + 1, size);
+        if (literal) data += (count + 1) / 2;
+        size -= count;
+    }
+    return data - image->data;
+}
+
+// Color of pixel (x, y) of the image, decoded the slow way
+static uint16_t sim_bench_image_pixel(const image_t *image, size_t x, size_t y, uint16_t color, uint16_t back_color) {
+    static uint8_t alpha[256 * 256];
+    static const image_t *decoded;
+
+    if (image->format == IMAGE_FORMAT_RGB565) return ((const uint16_t *) image->data)[y * image->width + x];
+    if (image->format == IMAGE_FORMAT_ALPHA) {
+        if (decoded != image) {
+            const font_t cell = { .height = image->height, .width = image->width };
+            font_gliph_alpha(&cell, image->data, alpha);
+            decoded = image;
+        }
+        return _mix_colors(color, back_color, alpha[y * image->width + x]);
+    }
+
+    size_t bits = IMAGE_INDEX_BITS(image->format);
+    size_t stride = (image->width * bits + 7) / 8;
+    size_t index = (image->data[y * stride + x * bits / 8] >> (8 - bits - (x * bits) % 8)) & ((1u << bits) - 1);
+    return image->palette[index];
+}
+
+// Every pixel of the panel is the image where it shows, the fill elsewhere
+static bool sim_bench_image_check(const image_t *image, size_t left, size_t top, const display_rect_t *clip, uint16_t color, uint16_t back_color) {
+    for (size_t y = 0; y < SIM_PANEL_HEIGHT; y++) {
+        for (size_t x = 0; x < SIM_PANEL_WIDTH; x++) {
+            bool inside = x >= left && x < left + image->width && y >= top && y < top + image->height
+                && x >= clip->left && x <= clip->right && y >= clip->top && y <= clip->bottom;
+            uint16_t expected = inside ? sim_bench_image_pixel(image, x - left, y - top, color, back_color) : COLOR_BLACK;
+            if (sim_framebuffer[y][x] != expected) return false;
+        }
+    }
+    return true;
+}
+
+// Each image is drawn over a cleared panel at its place, cut by a clip and
+// again unchanged, which the compositor must drop.
+static void sim_bench_image(const char *name, const image_t *image, uint16_t color, uint16_t back_color) {
+    static const display_rect_t panel = { 0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1 };
+    static const display_rect_t cut = { 20, DISPLAY_WIDTH - 1, 115, DISPLAY_HEIGHT - 1 };
+    const struct { const char *variant; const display_rect_t *clip; bool again; } variants[] = {
+        { "",         &panel, false },
+        { "_clipped", &cut,   false },
+        { "_redraw",  &panel, true  },
+    };
+
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+        const display_rect_t *clip = variants[i].clip;
+
+        display_set_clip(0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1);
+        display_fill_screen(COLOR_BLACK);
+        if (variants[i].again) display_draw_image(image, color, back_color, 10, 100);
+        display_set_clip(clip->left, clip->right, clip->top, clip->bottom);
+        sim_display_pump();
+
+        sim_wait_event(UINT64_MAX);
+        sim_reset_stats();
+        uint64_t start = sim_time_ps;
+
+        display_draw_image(image, color, back_color, 10, 100);
+        sim_display_pump();
+
+        uint64_t elapsed = sim_time_ps - start;
+        uint64_t cpu = elapsed - sim_stats.task_wait_ps + sim_stats.isr_ps;
+        printf("%s%s,%s,%zu,%llu,%llu,%llu,%.1f,%.1f,%d\n",
+            name, variants[i].variant,
+            sim_bench_image_formats[image->format],
+            sim_bench_image_bytes(image),
+            (unsigned long long) sim_stats.spi_bytes,
+            (unsigned long long) sim_stats.windows,
+            (unsigned long long) sim_stats.pixels_written,
+            (double) elapsed / 1e6,
+            (double) cpu / 1e6,
+            sim_bench_image_check(image, 10, 100, clip, color, back_color)
+        );
+    }
+    display_set_clip(0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1);
+    sim_display_pump();
+}
+
+static void sim_bench_images_suite(void) {
+    sim_bench_image_setup();
+    _display_compositor_reset();
+
+    printf("# suite=images\n");
+    printf("case,format,flash_bytes,spi_bytes,windows,pixels,time_us,cpu_us,match\n");
+    for (size_t i = 0; i < sizeof(sim_bench_images) / sizeof(sim_bench_images[0]); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s_%ux%u", sim_bench_image_formats[sim_bench_images[i].format], SIM_BENCH_IMAGE_WIDTH, SIM_BENCH_IMAGE_HEIGHT);
+        sim_bench_image(name, &sim_bench_images[i], COLOR_WHITE, COLOR_BLACK);
+    }
+    sim_bench_image("icon_heating", &icon_heating, COLOR_RED, COLOR_BLACK);
+    sim_bench_image("icon_fan", &icon_fan, COLOR_BLUE, COLOR_WHITE);
+    sim_bench_image("icon_alarm", &icon_alarm, 0xFFE0, COLOR_BLACK);
+}
+
+///////////////////////////////////////////////////////////////////////////////////// CHART ///
+
+#define SIM_BENCH_CHART_TOP      160
+#define SIM_BENCH_CHART_LINES    160
+#define SIM_BENCH_SAMPLES        400
+
+static chart_t sim_bench_chart;
+
+// A slow triangle wave with some jitter, in tenths of a degree
+static int32_t sim_bench_sample(size_t n) {
+    int32_t phase = n % 180;
+    return 1000 + 8 * (phase < 90 ? phase : 180 - phase) + (int32_t) (n * 37 % 11);
+}
+
+// Plot as the panel shows it, scrolling included
+static uint64_t sim_bench_chart_hash(void) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t y = SIM_BENCH_CHART_TOP; y < SIM_BENCH_CHART_TOP + SIM_BENCH_CHART_LINES; y++) {
+        const uint16_t *line = sim_framebuffer[sim_st7789_scanned_row(y)];
+        for (size_t x = 0; x < SIM_PANEL_WIDTH; x++) hash = (hash ^ line[x]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t sim_bench_chart_column(int32_t value) {
+    return (size_t) (value - 1000) * (DISPLAY_WIDTH - 1) / 800;
+}
+
+// Clear the plot and draw the trace of the last samples, oldest at the top
+static void sim_bench_chart_repaint(size_t count) {
+    size_t first = count > SIM_BENCH_CHART_LINES ? count - SIM_BENCH_CHART_LINES : 0;
+
+    display_fill_rect(COLOR_BLACK, 0, DISPLAY_WIDTH - 1, SIM_BENCH_CHART_TOP, SIM_BENCH_CHART_TOP + SIM_BENCH_CHART_LINES - 1);
+    for (size_t n = first; n < count; n++) {
+        size_t column = sim_bench_chart_column(sim_bench_sample(n));
+        size_t previous = n > 0 ? sim_bench_chart_column(sim_bench_sample(n - 1)) : column;
+        uint16_t row = SIM_BENCH_CHART_TOP + SIM_BENCH_CHART_LINES - (count - n);
+        display_fill_rect(COLOR_GREEN, min(column, previous), max(column, previous), row, row);
+    }
+    sim_display_pump();
+}
+
+static void sim_bench_chart_run(const char *name, bool scroll, size_t samples, uint64_t *hash) {
+    _display_compositor_reset();
+    display_fill_screen(COLOR_BLACK);
+    if (scroll) chart_init(&sim_bench_chart, SIM_BENCH_CHART_TOP, SIM_BENCH_CHART_LINES, 1000, 1800, COLOR_GREEN, COLOR_BLACK);
+    sim_display_pump();
+
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    uint64_t start_ps = sim_time_ps;
+
+    for (size_t n = 0; n < samples; n++) {
+        if (scroll) {
+            chart_add_sample(&sim_bench_chart, sim_bench_sample(n));
+            sim_display_pump();
+        } else {
+            sim_bench_chart_repaint(n + 1);
+        }
+    }
+
+    *hash = sim_bench_chart_hash();
+    printf("%s,%zu,%.1f,%.1f,%.3f,%llu\n",
+        name,
+        samples,
+        (double) sim_stats.spi_bytes / samples,
+        (double) sim_stats.windows / samples,
+        (double) (sim_time_ps - start_ps) / 1e6 / samples,
+        (unsigned long long) sim_stats.protocol_errors
+    );
+
+    if (scroll) {
+        chart_release(&sim_bench_chart);
+        sim_display_pump();
+    }
+}
+
+static void sim_bench_chart_suite(void) {
+    uint64_t scrolled, repainted;
+
+    printf("# suite=chart\n");
+    printf("mode,samples,spi_bytes_per_sample,windows_per_sample,us_per_sample,protocol_errors\n");
+    sim_bench_chart_run("scroll", true, SIM_BENCH_SAMPLES, &scrolled);
+    sim_bench_chart_run("repaint", false, SIM_BENCH_SAMPLES, &repainted);
+    printf("same_plot,%d\n", scrolled == repainted);
+}
+
+///////////////////////////////////////////////////////////////////////////////////// POWER ///
+
+#define SIM_BENCH_POWER_MS       30000
+#define SIM_BENCH_POWER_INPUT    20000
+
+extern SemaphoreHandle_t hDisplayRingData;
+extern SemaphoreHandle_t hDisplayWake;
+
+static TickType_t sim_bench_hold_until;
+static bool sim_bench_holding;
+
+// One tick of _display_task(), the waits it would block in are polled
+static void sim_bench_display_tick(TickType_t now) {
+    if (sim_bench_holding) {
+        if (now < sim_bench_hold_until && xSemaphoreTake(hDisplayWake, 0) != pdPASS) return;
+        sim_bench_holding = false;
+    } else if (xSemaphoreTake(hDisplayRingData, 0) == pdPASS) {
+        TickType_t hold = _display_power_hold(now);
+        if (hold > 0) {
+            sim_bench_hold_until = now + hold;
+            sim_bench_holding = true;
+            return;
+        }
+    } else {
+        if (_display_power_timeout(now) == 0) _display_power_enter();
+        return;
+    }
+
+    display_stats.wakeups++;
+    _display_power_update(false);
+    while (_display_compose());
+}
+
+static uint64_t sim_bench_power(const char *name, TickType_t timeout) {
+    static display_text_field_t readout;
+    wchar_t value[8];
+    size_t updates = 0;
+    size_t low_power_ms = 0;
+
+    _display_compositor_reset();
+    display_fill_screen(COLOR_BLACK);
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 128, L"Static");
+    display_text_field_init(&readout, &fira_code, 0, 0, 6);
+    display_set_power_policy(0, fira_code.height - 1, timeout);
+    sim_bench_holding = false;
+    sim_display_pump();
+
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    memset(&display_stats, 0, sizeof(display_stats));
+    TickType_t start = xTaskGetTickCount() + 1;
+
+    for (TickType_t ms = 0; ms < SIM_BENCH_POWER_MS; ms++) {
+        uint64_t tick_ps = (start + ms) * SIM_PS_PER_TICK;
+        if (sim_time_ps < tick_ps) sim_advance(tick_ps);
+
+        if (ms % 100 == 0) {
+            swprintf(value, sizeof(value) / sizeof(value[0]), L"%3zu.%zu°", 100 + updates / 10, updates % 10);
+            display_text_field_set(&readout, COLOR_WHITE, COLOR_BLACK, value);
+            updates++;
+        }
+        if (ms == SIM_BENCH_POWER_INPUT) display_wake();
+
+        sim_bench_display_tick(xTaskGetTickCount());
+        if (display_low_power) low_power_ms++;
+    }
+
+    // Whatever is still held back, then compare what GRAM ends up with
+    display_wake();
+    sim_bench_display_tick(xTaskGetTickCount());
+    sim_bench_display_tick(xTaskGetTickCount());
+
+    printf("%s,%d,%zu,%lu,%llu,%llu,%lu,%zu\n",
+        name,
+        SIM_BENCH_POWER_MS / 1000,
+        updates,
+        (unsigned long) display_stats.wakeups,
+        (unsigned long long) sim_stats.spi_bytes,
+        (unsigned long long) sim_stats.windows,
+        (unsigned long) display_stats.low_power_entries,
+        low_power_ms
+    );
+
+    display_set_power_policy(0, DISPLAY_HEIGHT - 1, DISPLAY_POWER_TIMEOUT);
+    sim_display_pump();
+    return sim_bench_framebuffer_hash();
+}
+
+static void sim_bench_power_suite(void) {
+    printf("# suite=power\n");
+    printf("mode,seconds,updates,wakeups,spi_bytes,windows,low_power_entries,low_power_ms\n");
+    uint64_t normal = sim_bench_power("normal", 0);
+    uint64_t managed = sim_bench_power("managed", pdMS_TO_TICKS(2000));
+    printf("same_gram,%d\n", normal == managed);
+}
+
+///////////////////////////////////////////////////////////////////////////////////// VSYNC ///
+
+#define SIM_BENCH_VSYNC_PAGES    60
+
+// With slpout the panel is set up again first, the timer starts from a
+// known phase and the nominal period
+static void sim_bench_vsync(const char *name, display_vsync_t mode, bool slpout) {
+    display_stats_t stats;
+
+    if (slpout) _display_init();
+    _display_compositor_reset();
+    display_set_vsync(mode);
+    display_fill_screen(COLOR_BLACK);
+    sim_display_pump();
+
+    // Some refreshes for the TE period to settle
+    if (!slpout) vTaskDelay(pdMS_TO_TICKS(200));
+    sim_reset_stats();
+    memset(&display_stats, 0, sizeof(display_stats));
+    uint64_t start = sim_time_ps;
+
+    for (size_t page = 0; page < SIM_BENCH_VSYNC_PAGES; page++) {
+        uint16_t color = (page & 1) ? COLOR_BLUE : COLOR_RED;
+        display_fill_screen(color);
+        display_draw_rect(COLOR_BLACK, COLOR_WHITE, 20, DISPLAY_WIDTH - 21, 120, 279, 2);
+        display_draw_text(&fira_code, COLOR_WHITE, color, 0, 0, page & 1 ? L"Page 2" : L"Page 1");
+        sim_display_pump();
+    }
+
+    display_get_stats(&stats);
+    printf("%s,%d,%llu,%llu,%lu,%lu,%lu,%lu,%llu\n",
+        name,
+        SIM_BENCH_VSYNC_PAGES,
+        (unsigned long long) sim_stats.windows,
+        (unsigned long long) sim_stats.torn_frames,
+        (unsigned long) stats.vsync_windows,
+        (unsigned long) stats.vsync_late,
+        (unsigned long) stats.vsync_wait_us_max,
+        (unsigned long) stats.frame_us,
+        (unsigned long long) ((sim_time_ps - start) / (SIM_PS_PER_SECOND / 1000000) / SIM_BENCH_VSYNC_PAGES)
+    );
+
+    display_set_vsync(DISPLAY_VSYNC);
+}
+
+static void sim_bench_vsync_suite(void) {
+    printf("# suite=vsync\n");
+    printf("mode,pages,windows,torn_frames,vsync_windows,vsync_late,wait_us_max,frame_us,us_per_page\n");
+    sim_bench_vsync("off", DISPLAY_VSYNC_OFF, false);
+    sim_bench_vsync("te", DISPLAY_VSYNC_TE, false);
+    sim_bench_vsync("timer_slpout", DISPLAY_VSYNC_TIMER, true);
+    sim_bench_vsync("timer", DISPLAY_VSYNC_TIMER, false);
+}
+
+//////////////////////////////////////////////////////////////////////////////////// WINDOW ///
+
+#define SIM_BENCH_WINDOWS   1000
+
+static double sim_bench_us(uint64_t ps) {
+    return (double) ps / (SIM_PS_PER_SECOND / 1000000) / SIM_BENCH_WINDOWS;
+}
+
+static void sim_bench_window_print(const char *name, uint64_t elapsed) {
+    // The task computes unless it is blocked, handlers compute while it is
+    uint64_t cpu = elapsed - sim_stats.task_wait_ps + sim_stats.isr_ps;
+    printf("%s,%.3f,%.3f,%.1f\n", name, sim_bench_us(elapsed), sim_bench_us(cpu), (double) sim_stats.spi_bytes / SIM_BENCH_WINDOWS);
+}
+
+// Windows opened back to back, each RAMWR is left without pixels
+static void sim_bench_window(const char *name, bool columns) {
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    uint64_t start = sim_time_ps;
+
+    for (size_t i = 0; i < SIM_BENCH_WINDOWS; i++) {
+        size_t left = columns ? (i & 1) * 100 : 0;
+        _display_set_window(left, left + 31, (i * 8) % 256, (i * 8) % 256 + 47);
+    }
+    sim_bench_window_print(name, sim_time_ps - start);
+    _display_write_words(ST7789_NOP, NULL, 0);
+}
+
+static void sim_bench_window_fill(void) {
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    uint64_t start = sim_time_ps;
+
+    for (size_t i = 0; i < SIM_BENCH_WINDOWS; i++) {
+        size_t x = i % DISPLAY_WIDTH;
+        _display_color_fill_dma(x, x, 0, 0, COLOR_WHITE);
+    }
+    sim_bench_window_print("fill_1px", sim_time_ps - start);
+}
+
+static void sim_bench_window_suite(void) {
+    printf("# suite=window\n");
+    printf("case,us_per_window,cpu_us_per_window,spi_bytes_per_window\n");
+    sim_bench_window("columns_and_rows", true);
+    sim_bench_window("rows_only", false);
+    sim_bench_window_fill();
+}
+
+//////////////////////////////////////////////////////////////////////////////////// POLICY ///
+
+#define SIM_BENCH_UPDATES 64
+
+// Returns the framebuffer hash once the last update is on the panel
+static uint64_t sim_bench_policy(const char *name, display_policy_t policy, uint64_t expected) {
+    wchar_t value[8];
+    display_fence_t fence = DISPLAY_FENCE_NONE;
+    size_t accepted = 0;
+
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    memset(&display_stats, 0, sizeof(display_stats));
+    _display_compositor_reset();
+    display_set_policy(policy, portMAX_DELAY);
+    uint64_t start_ps = sim_time_ps;
+
+    // Nothing drains the ring while the burst is submitted, unless a
+    // producer blocks
+    display_fill_screen(COLOR_BLACK);
+    for (size_t n = 0; n < SIM_BENCH_UPDATES; n++) {
+        swprintf(value, sizeof(value) / sizeof(value[0]), L"%3zu.%zu°", 100 + n / 10, n % 10);
+        display_fence_t update = display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 64, value);
+        if (update != DISPLAY_FENCE_NONE) {
+            fence = update;
+            accepted++;
+        }
+    }
+    uint64_t submit_ps = sim_time_ps;
+
+    bool reached = display_fence_wait(fence, portMAX_DELAY);
+    uint64_t hash = sim_bench_framebuffer_hash();
+
+    display_stats_t stats;
+    display_get_stats(&stats);
+    printf("%s,%d,%zu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.3f,%.3f,%d,%d\n",
+        name,
+        SIM_BENCH_UPDATES,
+        accepted,
+        (unsigned long) stats.commands_rejected,
+        (unsigned long) stats.commands_replaced,
+        (unsigned long) stats.commands,
+        (unsigned long) stats.queue_depth_max,
+        (unsigned long) stats.ring_bytes_max,
+        (unsigned long) stats.stalls,
+        (unsigned long) stats.stall_ticks,
+        (double) (submit_ps - start_ps) / 1e9,
+        (double) (sim_time_ps - start_ps) / 1e9,
+        reached && stats.queue_depth == 0,
+        expected == 0 || hash == expected
+    );
+
+    display_set_policy(DISPLAY_POLICY, DISPLAY_POLICY_TIMEOUT);
+    return hash;
+}
+
+/////////////////////////////////////////////////////////////////////////////// GLIPH CACHE ///
+
+#define SIM_BENCH_READOUTS  10
+
+// Windows per update, a cold pass gets no hits
+static double sim_bench_gliph_cache_pass(const char *pass, bool cold, double cold_windows) {
+    wchar_t value[8];
+    display_stats_t stats;
+
+    sim_wait_event(UINT64_MAX);
+    sim_reset_stats();
+    memset(&display_stats, 0, sizeof(display_stats));
+    _display_compositor_reset();
+
+    for (size_t n = 0; n < SIM_BENCH_READOUTS; n++) {
+        if (cold) _display_gliph_cache_reset();
+        swprintf(value, sizeof(value) / sizeof(value[0]), L"%3zu.%zu°", 120 + n / 10, n % 10);
+        display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, value);
+        sim_display_pump();
+    }
+
+    display_get_stats(&stats);
+    double windows = (double) sim_stats.windows / SIM_BENCH_READOUTS;
+    bool same_windows = cold || windows == cold_windows;
+    printf("%s,%d,%lu,%lu,%.1f,%lu,%lu,%lu,%.1f,%.1f,%d\n",
+        pass,
+        SIM_BENCH_READOUTS,
+        (unsigned long) stats.gliph_cache_hits,
+        (unsigned long) stats.gliph_cache_misses,
+        100.0 * stats.gliph_cache_hits / (stats.gliph_cache_hits + stats.gliph_cache_misses),
+        (unsigned long) stats.gliph_cache_evictions,
+        (unsigned long) stats.gliph_cache_entries,
+        (unsigned long) stats.gliph_cache_bytes,
+        windows,
+        (double) sim_stats.spi_bytes / SIM_BENCH_READOUTS,
+        same_windows
+    );
+    if (!same_windows) fprintf(stderr, "sim: glyph cache pass %s sends %.1f windows per update, %.1f without it\n", pass, windows, cold_windows);
+    return windows;
+}
+
+static void sim_bench_gliph_cache(void) {
+    static const char * const passes[] = { "0", "1", "2" };
+
+    printf("# suite=gliph_cache\n");
+    printf("pass,updates,hits,misses,hit_percent,evictions,entries,cache_bytes,windows_per_update,spi_bytes_per_update,same_windows\n");
+
+    double cold_windows = sim_bench_gliph_cache_pass("cold", true, 0);
+    _display_gliph_cache_reset();
+    for (size_t pass = 0; pass < 3; pass++) sim_bench_gliph_cache_pass(passes[pass], false, cold_windows);
+}
+
+//////////////////////////////////////////////////////////////////////////////////// SUITES ///
+
+static void sim_bench_commands_suite(void) {
+    uint64_t sck_hz = sim_spi_clock_hz(DISPLAY_SPI);
+
+    printf("# suite=commands spi_clock_hz=%llu\n", (unsigned long long) sck_hz);
+    printf("case,command,spi_bytes,dma_transfers,windows,pixels,solid_pixels,overdrawn,line_us,time_us,protocol_errors\n");
+
+    for (size_t i = 0; i < sizeof(sim_bench_commands) / sizeof(sim_bench_commands[0]); i++) {
+        const sim_bench_case_t *bench = &sim_bench_commands[i];
+
+        // Every case is measured on its own, never as a redraw of the previous one
+        sim_wait_event(UINT64_MAX);
+        sim_reset_stats();
+        _display_compositor_reset();
+        uint64_t start_ps = sim_time_ps;
+
+        bench->run();
+        sim_display_pump();
+
+        // Line time is the bytes alone, time also counts register accesses,
+        // polling gaps and DMA/ISR turnaround as modelled by the simulator.
+        double line_us = (double) sim_stats.spi_bytes * 8 * 1e6 / (double) sck_hz;
+        double time_us = (double) (sim_time_ps - start_ps) / 1e6;
+
+        printf("%s,%s,%llu,%llu,%llu,%llu,%llu,%llu,%.3f,%.3f,%llu\n",
+            bench->name,
+            bench->command,
+            (unsigned long long) sim_stats.spi_bytes,
+            (unsigned long long) sim_stats.dma_transfers,
+            (unsigned long long) sim_stats.windows,
+            (unsigned long long) (sim_stats.pixels_written + sim_stats.pixels_discarded),
+            (unsigned long long) sim_stats.dma_items_fixed,
+            (unsigned long long) sim_stats.pixels_overdrawn,
+            line_us,
+            time_us,
+            (unsigned long long) sim_stats.protocol_errors
+        );
+    }
+}
+
+static void sim_bench_lookup_suite(void) {
+    sim_bench_lookup(&fira_code);
+}
+
+static void sim_bench_blend_suite(void) {
+    printf("# suite=blend\n");
+    printf("code,fore,back,ns_mix,ns_lut_build,ns_decode,match\n");
+    sim_bench_blend(&fira_code, L"8W.", COLOR_WHITE, COLOR_BLACK);
+    sim_bench_blend(&fira_code, L"8W.", COLOR_RED, COLOR_BLUE);
+}
+
+static void sim_bench_font_suite(void) {
+    sim_bench_font(&fira_code);
+}
+
+static void sim_bench_text_field_suite(void) {
+    sim_bench_text_field();
+}
+
+static void sim_bench_gliph_cache_suite(void) {
+    sim_bench_gliph_cache();
+}
+
+static void sim_bench_ring_suite(void) {
+    sim_bench_ring();
+}
+
+static void sim_bench_compositor_suite(void) {
+    printf("# suite=compositor\n");
+    printf("mode,frames,commands,dropped,merged,pixels_submitted,pixels_drawn,pixels_saved,spi_bytes,windows,time_us,protocol_errors\n");
+    sim_bench_compositor("bypass", true);
+    sim_bench_compositor("compositor", false);
+}
+
+static void sim_bench_list_suite(void) {
+    printf("# suite=list\n");
+    printf("mode,frames,commits,batches,commands,dropped,merged,spi_bytes,time_us\n");
+    sim_bench_list("calls_woken_each", SIM_BENCH_WAKE_EACH);
+    sim_bench_list("calls_woken_once", SIM_BENCH_WAKE_ONCE);
+    sim_bench_list("display_list", SIM_BENCH_LIST);
+}
+
+static void sim_bench_bands_suite(void) {
+    printf("# suite=bands\n");
+    printf("scene,mode,frames,commands_drawn,windows,spi_bytes,solid_pixels,time_us,protocol_errors,same_panel\n");
+    uint64_t expected = sim_bench_bands("status", sim_bench_status_screen, "direct", DISPLAY_RENDER_DIRECT, 0);
+    sim_bench_bands("status", sim_bench_status_screen, "bands", DISPLAY_RENDER_BANDS, expected);
+    expected = sim_bench_bands("overlap", sim_bench_overlap_screen, "direct", DISPLAY_RENDER_DIRECT, 0);
+    sim_bench_bands("overlap", sim_bench_overlap_screen, "bands", DISPLAY_RENDER_BANDS, expected);
+    expected = sim_bench_bands("clipped", sim_bench_clipped_screen, "direct", DISPLAY_RENDER_DIRECT, 0);
+    sim_bench_bands("clipped", sim_bench_clipped_screen, "bands", DISPLAY_RENDER_BANDS, expected);
+}
+
+static void sim_bench_policy_suite(void) {
+    printf("# suite=policy\n");
+    printf("policy,updates,accepted,rejected,replaced,drawn,depth_max,ring_bytes_max,stalls,stall_ms,submit_ms,total_ms,fence_reached,last_value_shown\n");
+    uint64_t expected = sim_bench_policy("block", DISPLAY_POLICY_BLOCK, 0);
+    sim_bench_policy("drop", DISPLAY_POLICY_DROP, expected);
+    sim_bench_policy("overwrite", DISPLAY_POLICY_OVERWRITE, expected);
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} sim_bench_suites[] = {
+    { "commands",   sim_bench_commands_suite    },
+    { "lookup",     sim_bench_lookup_suite      },
+    { "blend",      sim_bench_blend_suite       },
+    { "font",       sim_bench_font_suite        },
+    { "text_field", sim_bench_text_field_suite  },
+    { "gliph_cache", sim_bench_gliph_cache_suite },
+    { "ring",       sim_bench_ring_suite        },
+    { "compositor", sim_bench_compositor_suite  },
+    { "list",       sim_bench_list_suite        },
+    { "bands",      sim_bench_bands_suite       },
+    { "shapes",     sim_bench_shapes_suite      },
+    { "images",     sim_bench_images_suite      },
+    { "chart",      sim_bench_chart_suite       },
+    { "power",      sim_bench_power_suite       },
+    { "vsync",      sim_bench_vsync_suite       },
+    { "window",     sim_bench_window_suite      },
+    { "policy",     sim_bench_policy_suite      },
+};
+
+///////////////////////////////////////////////////////////////////////////////////// ENTRY ///
+
+// Run one suite by name, or all of them when suite is NULL
+int sim_bench(const char *suite) {
+    bool found = false;
+    for (size_t i = 0; i < sizeof(sim_bench_suites) / sizeof(sim_bench_suites[0]); i++) {
+        if (suite != NULL && strcmp(suite, sim_bench_suites[i].name) != 0) continue;
+        sim_bench_suites[i].run();
+        found = true;
+    }
+
+    if (!found) {
+        fprintf(stderr, "sim: unknown benchmark suite '%s'\n", suite);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "sim.h"
+
+struct sim_task {
+    const char *name;
+    TaskFunction_t code;
+    void *parameters;
+    uint32_t notify_value;
+    bool notified;
+};
+
+struct sim_queue {
+    size_t length;
+    size_t item_size;
+    size_t head;
+    size_t count;
+    uint8_t *storage;
+};
+
+void (*sim_idle_hook)(void);
+struct sim_task *sim_current_task;
+
+////////////////////////////////////////////////////////////////////////////////// INTERNAL ///
+
+static uint64_t sim_deadline(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) return UINT64_MAX;
+    return sim_time_ps + ticks * SIM_PS_PER_TICK;
+}
+
+// Nothing else can run on the single host thread, so a task waiting on a
+// notification just lets the hardware model run until an interrupt posts it.
+static bool sim_wait_notified(TickType_t ticks) {
+    uint64_t deadline = sim_deadline(ticks);
+    uint64_t start = sim_time_ps;
+    bool notified = true;
+
+    while (!sim_current_task->notified) {
+        if (!sim_wait_event(deadline)) {
+            if (deadline == UINT64_MAX) {
+                fprintf(stderr, "sim: task '%s' waits forever for a notification\n", sim_current_task->name);
+                abort();
+            }
+            notified = false;
+            break;
+        }
+    }
+    sim_stats.task_wait_ps += sim_time_ps - start;
+    return notified;
+}
+
+////////////////////////////////////////////////////////////////////////////////////// TASK ///
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask) {
+    (void) usStackDepth;
+    (void) uxPriority;
+
+    struct sim_task *task = calloc(1, sizeof(struct sim_task));
+    if (task == NULL) return pdFAIL;
+
+    task->name       = pcName;
+    task->code       = pxTaskCode;
+    task->parameters = pvParameters;
+    if (pxCreatedTask != NULL) *pxCreatedTask = task;
+    return pdPASS;
+}
+
+void vTaskStartScheduler(void) {
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay) {
+    sim_advance(sim_time_ps + xTicksToDelay * SIM_PS_PER_TICK);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return sim_time_ps / SIM_PS_PER_TICK;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return sim_current_task;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue, TickType_t xTicksToWait) {
+    if (!sim_current_task->notified) sim_current_task->notify_value &= ~ulBitsToClearOnEntry;
+    if (!sim_wait_notified(xTicksToWait)) return pdFAIL;
+
+    if (pulNotificationValue != NULL) *pulNotificationValue = sim_current_task->notify_value;
+    sim_current_task->notify_value &= ~ulBitsToClearOnExit;
+    sim_current_task->notified = false;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+    uint64_t deadline = sim_deadline(xTicksToWait);
+    uint64_t start = sim_time_ps;
+
+    while (sim_current_task->notify_value == 0) {
+        if (!sim_wait_event(deadline)) {
+            if (deadline == UINT64_MAX) {
+                fprintf(stderr, "sim: task '%s' waits forever for a notification\n", sim_current_task->name);
+                abort();
+            }
+            sim_stats.task_wait_ps += sim_time_ps - start;
+            return 0;
+        }
+    }
+    sim_stats.task_wait_ps += sim_time_ps - start;
+
+    uint32_t value = sim_current_task->notify_value;
+    sim_current_task->notify_value = xClearCountOnExit ? 0 : value - 1;
+    sim_current_task->notified = false;
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+    xTaskToNotify->notify_value++;
+    xTaskToNotify->notified = true;
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken) {
+    xTaskToNotify->notify_value++;
+    xTaskToNotify->notified = true;
+    if (pxHigherPriorityTaskWoken != NULL) *pxHigherPriorityTaskWoken = pdTRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////////// QUEUE ///
+
+QueueHandle_t xQueueCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize) {
+    struct sim_queue *queue = calloc(1, sizeof(struct sim_queue));
+    if (queue == NULL) return NULL;
+
+    queue->length    = uxQueueLength;
+    queue->item_size = uxItemSize;
+    queue->storage   = calloc(uxQueueLength, uxItemSize);
+    if (queue->storage == NULL) {
+        free(queue);
+        return NULL;
+    }
+    return queue;
+}
+
+// A full queue would block the producer until the consumer task drains it.
+// The harness installs sim_idle_hook to run the consumer in that case.
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait) {
+    if (xQueue->count == xQueue->length && xTicksToWait != 0 && sim_idle_hook != NULL) {
+        sim_idle_hook();
+    }
+    if (xQueue->count == xQueue->length) return errQUEUE_FULL;
+
+    size_t tail = (xQueue->head + xQueue->count) % xQueue->length;
+    memcpy(&xQueue->storage[tail * xQueue->item_size], pvItemToQueue, xQueue->item_size);
+    xQueue->count++;
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait) {
+    (void) xTicksToWait;
+    if (xQueue->count == 0) return errQUEUE_EMPTY;
+
+    memcpy(pvBuffer, &xQueue->storage[xQueue->head * xQueue->item_size], xQueue->item_size);
+    xQueue->head = (xQueue->head + 1) % xQueue->length;
+    xQueue->count--;
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue) {
+    return xQueue->count;
+}
+
+///////////////////////////////////////////////////////////////////////////////// SEMAPHORE ///
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *pxSemaphoreBuffer) {
+    *pxSemaphoreBuffer = (StaticSemaphore_t) { .count = 0, .max = 1 };
+    return pxSemaphoreBuffer;
+}
+
+// There is a single host thread, so the mutex is never contended
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *pxMutexBuffer) {
+    *pxMutexBuffer = (StaticSemaphore_t) { .count = 1, .max = 1 };
+    return pxMutexBuffer;
+}
+
+// Like a full queue, an empty semaphore would block the caller until the
+// consumer task gives it, sim_idle_hook runs the consumer instead. A timed
+// out wait still takes its time.
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime) {
+    if (xSemaphore->count == 0 && xBlockTime != 0 && sim_idle_hook != NULL) {
+        sim_idle_hook();
+    }
+    if (xSemaphore->count == 0) {
+        if (xBlockTime == portMAX_DELAY) {
+            fprintf(stderr, "sim: semaphore taken forever\n");
+            abort();
+        }
+        sim_advance(sim_deadline(xBlockTime));
+        return pdFAIL;
+    }
+
+    xSemaphore->count--;
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore) {
+    if (xSemaphore->count == xSemaphore->max) return pdFAIL;
+    xSemaphore->count++;
+    return pdPASS;
+}
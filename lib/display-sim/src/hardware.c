@@ -0,0 +1,785 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "sim.h"
+
+// Display panel wiring comes from the firmware configuration, the same way the
+// real panel is wired to the pins listed in config.h.
+
+sim_stats_t sim_stats;
+uint64_t sim_time_ps;
+
+static bool sim_in_isr;
+static bool sim_irq_enabled[NVIC_IRQ_COUNT];
+static uint16_t sim_gpio_odr[3];
+
+////////////////////////////////////////////////////////////////////////////////// INTERNAL ///
+
+typedef struct {
+    uint32_t base;
+    uint64_t pclk_hz;
+    uint64_t sck_hz;
+    bool enabled;
+    bool dff_16bit;
+    bool tx_dma;
+    bool pending;
+    uint16_t pending_frame;
+    uint64_t txe_ps;
+    uint64_t idle_ps;
+    bool rx_pending;        // A frame is being received, RXNE sets at rx_ps
+    uint64_t rx_ps;
+    bool rxne;
+    bool rxne_interrupt;
+    bool ovr;               // Frames received from now on are lost
+    bool ovr_dr_read;       // DR was read since OVR set, reading SR clears it
+    uint8_t irqn;
+    void (*isr)(void);
+    uint32_t sr;
+} sim_spi_t;
+
+typedef struct {
+    bool enabled;
+    bool running;
+    bool memory_increment;
+    bool double_buffer;
+    bool tc_interrupt;
+    bool current_target;
+    uint16_t ndtr;
+    uint16_t ndtr_reload;
+    uint32_t m0ar;
+    uint32_t m1ar;
+    uint32_t par;
+    uint32_t flags;
+    uint64_t tc_ps;
+    const uint16_t *source;
+    size_t source_items;
+    uint64_t source_hash;
+} sim_dma_stream_t;
+
+void spi1_isr(void) __attribute__((weak));
+void spi2_isr(void) __attribute__((weak));
+
+static sim_spi_t sim_spi[2] = {
+    { .base = SPI1, .pclk_hz = SIM_APB2_HZ, .sck_hz = SIM_APB2_HZ / 2, .irqn = NVIC_SPI1_IRQ, .isr = spi1_isr },
+    { .base = SPI2, .pclk_hz = SIM_APB1_HZ, .sck_hz = SIM_APB1_HZ / 2, .irqn = NVIC_SPI2_IRQ, .isr = spi2_isr },
+};
+
+static sim_dma_stream_t sim_dma[2][8];
+static volatile uint32_t sim_dma_ifcr_scratch;
+
+static const uint8_t sim_dma_irqn[2][8] = {
+    { NVIC_DMA1_STREAM0_IRQ, NVIC_DMA1_STREAM1_IRQ, NVIC_DMA1_STREAM2_IRQ, NVIC_DMA1_STREAM3_IRQ,
+      NVIC_DMA1_STREAM4_IRQ, NVIC_DMA1_STREAM5_IRQ, NVIC_DMA1_STREAM6_IRQ, NVIC_DMA1_STREAM7_IRQ },
+    { NVIC_DMA2_STREAM0_IRQ, NVIC_DMA2_STREAM1_IRQ, NVIC_DMA2_STREAM2_IRQ, NVIC_DMA2_STREAM3_IRQ,
+      NVIC_DMA2_STREAM4_IRQ, NVIC_DMA2_STREAM5_IRQ, NVIC_DMA2_STREAM6_IRQ, NVIC_DMA2_STREAM7_IRQ },
+};
+
+// Interrupt handlers are provided by the firmware, the rest stay unresolved
+void dma1_stream0_isr(void) __attribute__((weak));
+void dma1_stream1_isr(void) __attribute__((weak));
+void dma1_stream2_isr(void) __attribute__((weak));
+void dma1_stream3_isr(void) __attribute__((weak));
+void dma1_stream4_isr(void) __attribute__((weak));
+void dma1_stream5_isr(void) __attribute__((weak));
+void dma1_stream6_isr(void) __attribute__((weak));
+void dma1_stream7_isr(void) __attribute__((weak));
+void dma2_stream0_isr(void) __attribute__((weak));
+void dma2_stream1_isr(void) __attribute__((weak));
+void dma2_stream2_isr(void) __attribute__((weak));
+void dma2_stream3_isr(void) __attribute__((weak));
+void dma2_stream4_isr(void) __attribute__((weak));
+void dma2_stream5_isr(void) __attribute__((weak));
+void dma2_stream6_isr(void) __attribute__((weak));
+void dma2_stream7_isr(void) __attribute__((weak));
+
+void DISPLAY_TE_ISR(void) __attribute__((weak));
+
+// EXTI lines: interrupt mask, rising edge triggers, pending flags. Only the TE
+// line of the display is wired.
+static struct {
+    uint32_t imr;
+    uint32_t rtsr;
+    uint32_t pr;
+    uint64_t te_ps;         // Last TE edge delivered
+} sim_exti;
+
+static void (* const sim_dma_isr[2][8])(void) = {
+    { dma1_stream0_isr, dma1_stream1_isr, dma1_stream2_isr, dma1_stream3_isr,
+      dma1_stream4_isr, dma1_stream5_isr, dma1_stream6_isr, dma1_stream7_isr },
+    { dma2_stream0_isr, dma2_stream1_isr, dma2_stream2_isr, dma2_stream3_isr,
+      dma2_stream4_isr, dma2_stream5_isr, dma2_stream6_isr, dma2_stream7_isr },
+};
+
+static inline uint64_t sim_max(uint64_t a, uint64_t b) {
+    return a > b ? a : b;
+}
+
+static sim_spi_t *sim_spi_get(uint32_t spi) {
+    for (size_t i = 0; i < sizeof(sim_spi) / sizeof(sim_spi[0]); i++) {
+        if (sim_spi[i].base == spi) return &sim_spi[i];
+    }
+    fprintf(stderr, "sim: unknown SPI 0x%08x\n", spi);
+    abort();
+}
+
+static sim_dma_stream_t *sim_dma_get(uint32_t dma, uint8_t stream) {
+    if ((dma != DMA1 && dma != DMA2) || stream > 7) {
+        fprintf(stderr, "sim: unknown DMA 0x%08x stream %u\n", dma, stream);
+        abort();
+    }
+    return &sim_dma[dma == DMA2][stream];
+}
+
+// Handlers do not nest, their time is accounted separately from the task's
+static void sim_call_isr(void (*isr)(void)) {
+    uint64_t start = sim_time_ps;
+    sim_in_isr = true;
+    isr();
+    sim_in_isr = false;
+    sim_stats.isr_ps += sim_time_ps - start;
+}
+
+static uint64_t sim_hash(const uint16_t *memory, size_t items) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < items; i++) hash = (hash ^ memory[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+static size_t sim_gpio_index(uint32_t gpioport) {
+    return (gpioport - GPIOA) / (GPIOB - GPIOA);
+}
+
+static void sim_access(uint64_t ps) {
+    sim_advance(sim_time_ps + ps);
+}
+
+static bool sim_spi_is_display(const sim_spi_t *spi) {
+    return spi->base == DISPLAY_SPI;
+}
+
+static bool sim_display_selected(void) {
+    return !(sim_gpio_odr[sim_gpio_index(DISPLAY_SPI_PORT)] & DISPLAY_CS_PIN);
+}
+
+static bool sim_display_data(void) {
+    return sim_gpio_odr[sim_gpio_index(DISPLAY_DC_PORT)] & DISPLAY_DC_PIN;
+}
+
+// RM0368 20.4.8: a frame received while RXNE is still set overruns, it and
+// every frame after it are lost until OVR is cleared
+static void sim_spi_receive(sim_spi_t *spi) {
+    spi->rx_pending = false;
+    if (spi->rxne || spi->ovr) {
+        if (spi->rxne_interrupt) sim_protocol_error("SPI frame lost to an overrun with RXNE interrupts on");
+        spi->ovr = true;
+    } else {
+        spi->rxne = true;
+    }
+}
+
+// Put one frame on the wire. Frames queue back-to-back behind the shift
+// register, the panel latches them with the DC/CS levels of the moment.
+static void sim_spi_shift(sim_spi_t *spi, uint16_t frame) {
+    unsigned bits = spi->dff_16bit ? 16 : 8;
+    uint64_t start = sim_max(sim_time_ps, spi->idle_ps);
+
+    spi->txe_ps  = start;
+    spi->idle_ps = start + bits * SIM_PS_PER_SECOND / spi->sck_hz;
+
+    // Full duplex: the frame clocked in with it completes with the last bit,
+    // the previous one is in by the time this one starts
+    if (spi->rx_pending) sim_spi_receive(spi);
+    spi->rx_pending = true;
+    spi->rx_ps = spi->idle_ps;
+
+    sim_stats.spi_frames++;
+    sim_stats.spi_bytes += bits / 8;
+
+    if (sim_spi_is_display(spi) && sim_display_selected()) {
+        bool data = sim_display_data();
+        if (spi->dff_16bit) sim_st7789_write(frame >> 8, data, start);
+        sim_st7789_write(frame & 0xFF, data, start);
+    }
+}
+
+static void sim_dma_try_start(sim_dma_stream_t *stream) {
+    if (!stream->enabled || stream->running) return;
+
+    sim_spi_t *spi = NULL;
+    for (size_t i = 0; i < sizeof(sim_spi) / sizeof(sim_spi[0]); i++) {
+        if (sim_spi[i].base + 0x0C == stream->par) spi = &sim_spi[i];
+    }
+    if (spi == NULL || !spi->tx_dma || !spi->enabled) return;
+
+    if (stream->ndtr == 0) {
+        sim_protocol_error("DMA stream enabled with NDTR = 0");
+        stream->enabled = false;
+        return;
+    }
+
+    // DMA addresses are 32-bit on the target, the host build is linked
+    // without PIE so static buffers stay below 4 GiB and survive the cast.
+    uint32_t address = stream->current_target ? stream->m1ar : stream->m0ar;
+    const uint16_t *memory = (const uint16_t *) (uintptr_t) address;
+
+    // The transfer is decoded up front, remember the source to catch the CPU
+    // writing into memory the real DMA would still be reading.
+    stream->source       = memory;
+    stream->source_items = stream->memory_increment ? stream->ndtr : 1;
+    stream->source_hash  = sim_hash(memory, stream->source_items);
+
+    stream->running = true;
+    for (size_t i = 0; i < stream->ndtr; i++) {
+        sim_spi_shift(spi, memory[stream->memory_increment ? i : 0]);
+    }
+    sim_stats.dma_items += stream->ndtr;
+    if (!stream->memory_increment) sim_stats.dma_items_fixed += stream->ndtr;
+
+    // The last item leaves memory one frame before it leaves the wire
+    stream->tc_ps = spi->txe_ps;
+}
+
+static void sim_dma_complete(size_t controller, size_t index) {
+    sim_dma_stream_t *stream = &sim_dma[controller][index];
+
+    if (sim_hash(stream->source, stream->source_items) != stream->source_hash) {
+        sim_protocol_error("DMA source memory modified during the transfer");
+    }
+
+    stream->running = false;
+    stream->flags |= DMA_TCIF;
+    if (stream->double_buffer) {
+        stream->current_target = !stream->current_target;
+        stream->ndtr = stream->ndtr_reload;
+    } else {
+        stream->ndtr = 0;
+        stream->enabled = false;
+    }
+
+    uint8_t irqn = sim_dma_irqn[controller][index];
+    if (stream->tc_interrupt && sim_irq_enabled[irqn] && sim_dma_isr[controller][index] != NULL) {
+        sim_call_isr(sim_dma_isr[controller][index]);
+    }
+
+    sim_dma_try_start(stream);
+}
+
+static uint64_t sim_next_te(void) {
+    if (!(sim_exti.imr & sim_exti.rtsr & DISPLAY_TE_EXTI)) return UINT64_MAX;
+    return sim_st7789_next_te(sim_exti.te_ps);
+}
+
+static void sim_te_edge(uint64_t ps) {
+    sim_exti.te_ps = ps;
+    sim_exti.pr |= DISPLAY_TE_EXTI;
+    if (sim_irq_enabled[DISPLAY_TE_IRQ] && DISPLAY_TE_ISR != NULL) sim_call_isr(DISPLAY_TE_ISR);
+}
+
+// A frame lost to an overrun does not interrupt
+static void sim_spi_rxne(sim_spi_t *spi) {
+    if (spi->rx_pending) sim_spi_receive(spi);
+    if (spi->rxne) sim_call_isr(spi->isr);
+}
+
+typedef enum {
+    SIM_EVENT_DMA,
+    SIM_EVENT_SPI,
+    SIM_EVENT_TE,
+} sim_event_kind_t;
+
+typedef struct {
+    sim_event_kind_t kind;
+    size_t controller;
+    size_t index;
+    uint64_t ps;
+} sim_event_t;
+
+// Earliest interrupt that becomes due, DMA completions first on a tie
+static bool sim_next_event(sim_event_t *event) {
+    event->ps = UINT64_MAX;
+    for (size_t c = 0; c < 2; c++) {
+        for (size_t i = 0; i < 8; i++) {
+            if (sim_dma[c][i].running && sim_dma[c][i].tc_ps < event->ps) {
+                *event = (sim_event_t) { SIM_EVENT_DMA, c, i, sim_dma[c][i].tc_ps };
+            }
+        }
+    }
+    for (size_t i = 0; i < sizeof(sim_spi) / sizeof(sim_spi[0]); i++) {
+        const sim_spi_t *spi = &sim_spi[i];
+        if (!spi->rxne_interrupt || !sim_irq_enabled[spi->irqn] || spi->isr == NULL) continue;
+
+        // RXNE is a level, a frame already received interrupts at once
+        uint64_t ps = spi->rxne ? sim_time_ps : spi->rx_pending ? spi->rx_ps : UINT64_MAX;
+        if (ps < event->ps) *event = (sim_event_t) { SIM_EVENT_SPI, 0, i, ps };
+    }
+    uint64_t te = sim_next_te();
+    if (te < event->ps) *event = (sim_event_t) { SIM_EVENT_TE, 0, 0, te };
+    return event->ps != UINT64_MAX;
+}
+
+static void sim_run_event(const sim_event_t *event) {
+    switch (event->kind) {
+    case SIM_EVENT_DMA:
+        sim_dma_complete(event->controller, event->index);
+        break;
+
+    case SIM_EVENT_SPI:
+        sim_spi_rxne(&sim_spi[event->index]);
+        break;
+
+    case SIM_EVENT_TE:
+        sim_te_edge(event->ps);
+        break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////// CORE ///
+
+void sim_reset_stats(void) {
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    sim_st7789_reset_writes();
+}
+
+void sim_protocol_error(const char *what) {
+    sim_stats.protocol_errors++;
+    fprintf(stderr, "sim: %s\n", what);
+}
+
+// Move simulated time forward, running interrupt handlers that become due.
+// Handlers do not nest, time spent inside a handler just accumulates.
+void sim_advance(uint64_t until_ps) {
+    if (!sim_in_isr) {
+        sim_event_t event;
+        while (sim_next_event(&event) && event.ps <= until_ps) {
+            sim_time_ps = sim_max(sim_time_ps, event.ps);
+            sim_run_event(&event);
+        }
+    }
+    sim_time_ps = sim_max(sim_time_ps, until_ps);
+}
+
+// Block until the next hardware event or the deadline, whichever is first.
+// Returns false when the deadline passed without any event.
+bool sim_wait_event(uint64_t deadline_ps) {
+    sim_event_t event;
+    if (!sim_next_event(&event) || event.ps > deadline_ps) {
+        if (deadline_ps != UINT64_MAX) sim_advance(deadline_ps);
+        return false;
+    }
+    sim_advance(sim_max(event.ps, sim_time_ps));
+    return true;
+}
+
+uint64_t sim_spi_clock_hz(uint32_t spi) {
+    return sim_spi_get(spi)->sck_hz;
+}
+
+////////////////////////////////////////////////////////////////////////////////////// NVIC ///
+
+void nvic_enable_irq(uint8_t irqn) {
+    sim_irq_enabled[irqn] = true;
+}
+
+void nvic_disable_irq(uint8_t irqn) {
+    sim_irq_enabled[irqn] = false;
+}
+
+void nvic_set_priority(uint8_t irqn, uint8_t priority) {
+    (void) irqn;
+    (void) priority;
+}
+
+////////////////////////////////////////////////////////////////////////////////////// EXTI ///
+
+void exti_select_source(uint32_t exti, uint32_t gpioport) {
+    sim_access(SIM_APB2_ACCESS_PS);
+    if (exti == DISPLAY_TE_EXTI && gpioport != DISPLAY_TE_PORT) sim_protocol_error("TE line routed from the wrong port");
+}
+
+void exti_set_trigger(uint32_t extis, enum exti_trigger_type trig) {
+    sim_access(SIM_APB2_ACCESS_PS);
+    if (trig == EXTI_TRIGGER_FALLING) {
+        sim_exti.rtsr &= ~extis;
+    } else {
+        sim_exti.rtsr |= extis;
+    }
+}
+
+void exti_enable_request(uint32_t extis) {
+    sim_access(SIM_APB2_ACCESS_PS);
+    if (extis & ~sim_exti.imr & DISPLAY_TE_EXTI) sim_exti.te_ps = sim_time_ps;
+    sim_exti.imr |= extis;
+}
+
+void exti_disable_request(uint32_t extis) {
+    sim_access(SIM_APB2_ACCESS_PS);
+    sim_exti.imr &= ~extis;
+}
+
+void exti_reset_request(uint32_t extis) {
+    sim_access(SIM_APB2_ACCESS_PS);
+    sim_exti.pr &= ~extis;
+}
+
+uint32_t exti_get_flag_status(uint32_t exti) {
+    sim_access(SIM_APB2_ACCESS_PS);
+    return sim_exti.pr & exti;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////// DWT ///
+
+bool dwt_enable_cycle_counter(void) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    return true;
+}
+
+uint32_t dwt_read_cycle_counter(void) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    return (uint32_t) (sim_time_ps / 1000 * (SIM_HCLK_HZ / 1000000) / 1000);
+}
+
+////////////////////////////////////////////////////////////////////////////////////// GPIO ///
+
+static void sim_gpio_write(uint32_t gpioport, uint16_t gpios, bool level) {
+    sim_access(SIM_AHB_ACCESS_PS);
+
+    size_t port = sim_gpio_index(gpioport);
+    uint16_t previous = sim_gpio_odr[port];
+    sim_gpio_odr[port] = level ? (previous | gpios) : (previous & ~gpios);
+    uint16_t changed = previous ^ sim_gpio_odr[port];
+
+    const sim_spi_t *spi = sim_spi_get(DISPLAY_SPI);
+    if (gpioport == DISPLAY_DC_PORT && (changed & DISPLAY_DC_PIN)) {
+        if (sim_time_ps < spi->idle_ps) sim_protocol_error("DC changed while a frame was on the wire");
+    }
+    if (gpioport == DISPLAY_SPI_PORT && (changed & DISPLAY_CS_PIN)) {
+        if (sim_time_ps < spi->idle_ps) sim_protocol_error("CS changed while a frame was on the wire");
+        sim_st7789_select(!level);
+    }
+}
+
+void gpio_set(uint32_t gpioport, uint16_t gpios) {
+    sim_gpio_write(gpioport, gpios, true);
+}
+
+void gpio_clear(uint32_t gpioport, uint16_t gpios) {
+    sim_gpio_write(gpioport, gpios, false);
+}
+
+uint16_t gpio_get(uint32_t gpioport, uint16_t gpios) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    return sim_gpio_odr[sim_gpio_index(gpioport)] & gpios;
+}
+
+void gpio_mode_setup(uint32_t gpioport, uint8_t mode, uint8_t pull_up_down, uint16_t gpios) {
+    (void) gpioport; (void) mode; (void) pull_up_down; (void) gpios;
+    sim_access(SIM_AHB_ACCESS_PS);
+}
+
+void gpio_set_output_options(uint32_t gpioport, uint8_t otype, uint8_t speed, uint16_t gpios) {
+    (void) gpioport; (void) otype; (void) speed; (void) gpios;
+    sim_access(SIM_AHB_ACCESS_PS);
+}
+
+void gpio_set_af(uint32_t gpioport, uint8_t alt_func_num, uint16_t gpios) {
+    (void) gpioport; (void) alt_func_num; (void) gpios;
+    sim_access(SIM_AHB_ACCESS_PS);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////// SPI ///
+
+volatile uint32_t *sim_spi_sr(uint32_t spi_base) {
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_access(SIM_APB1_ACCESS_PS);
+
+    if (spi->rx_pending && sim_time_ps >= spi->rx_ps) sim_spi_receive(spi);
+
+    spi->sr = 0;
+    if (spi->rxne)                   spi->sr |= SPI_SR_RXNE;
+    if (sim_time_ps >= spi->txe_ps)  spi->sr |= SPI_SR_TXE;
+    if (spi->ovr)                    spi->sr |= SPI_SR_OVR;
+    if (sim_time_ps <  spi->idle_ps) spi->sr |= SPI_SR_BSY;
+
+    // Reading DR and then SR clears OVR
+    if (spi->ovr_dr_read) spi->ovr = false;
+    spi->ovr_dr_read = false;
+    return &spi->sr;
+}
+
+// Reading DR clears RXNE, nothing is wired to MISO
+volatile uint32_t *sim_spi_dr(uint32_t spi_base) {
+    static volatile uint32_t dr;
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_access(SIM_APB1_ACCESS_PS);
+
+    if (spi->rx_pending && sim_time_ps >= spi->rx_ps) sim_spi_receive(spi);
+    spi->rxne = false;
+    spi->ovr_dr_read = spi->ovr;
+    dr = 0xFFFF;
+    return &dr;
+}
+
+int spi_init_master(uint32_t spi_base, uint32_t br, uint32_t cpol, uint32_t cpha, uint32_t dff, uint32_t lsbfirst) {
+    (void) cpol; (void) cpha; (void) lsbfirst;
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_access(SIM_APB1_ACCESS_PS);
+
+    spi->sck_hz    = spi->pclk_hz >> ((br >> 3) + 1);
+    spi->dff_16bit = dff == SPI_CR1_DFF_16BIT;
+    spi->enabled   = false;
+    return 0;
+}
+
+void spi_enable(uint32_t spi_base) {
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_access(SIM_APB1_ACCESS_PS);
+
+    spi->enabled = true;
+    if (spi->pending) {
+        spi->pending = false;
+        sim_spi_shift(spi, spi->pending_frame);
+    }
+    for (size_t c = 0; c < 2; c++) {
+        for (size_t i = 0; i < 8; i++) sim_dma_try_start(&sim_dma[c][i]);
+    }
+}
+
+void spi_disable(uint32_t spi_base) {
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_access(SIM_APB1_ACCESS_PS);
+
+    if (sim_time_ps < spi->idle_ps) sim_protocol_error("SPI disabled while a frame was on the wire");
+    spi->enabled = false;
+}
+
+uint16_t spi_clean_disable(uint32_t spi_base) {
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_access(SIM_APB1_ACCESS_PS);
+
+    // Waits for TXE and BSY like libopencm3 does
+    sim_advance(spi->idle_ps);
+    spi->enabled = false;
+    return 0;
+}
+
+void spi_write(uint32_t spi_base, uint16_t data) {
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_access(SIM_APB1_ACCESS_PS);
+
+    if (!spi->enabled) {
+        if (spi->pending) sim_protocol_error("SPI frame overwritten before the peripheral was enabled");
+        spi->pending = true;
+        spi->pending_frame = data;
+        return;
+    }
+    if (sim_time_ps < spi->txe_ps) sim_protocol_error("SPI TX buffer overrun");
+    sim_spi_shift(spi, data);
+}
+
+void spi_send(uint32_t spi_base, uint16_t data) {
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_advance(spi->txe_ps);
+    spi_write(spi_base, data);
+}
+
+// RM0368 20.5.1: DFF is written only while SPE is clear
+static void sim_spi_set_dff(uint32_t spi_base, bool dff_16bit) {
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_access(SIM_APB1_ACCESS_PS);
+
+    if (spi->enabled && spi->dff_16bit != dff_16bit) sim_protocol_error("SPI frame size changed while the peripheral was enabled");
+    spi->dff_16bit = dff_16bit;
+}
+
+// Waits for RXNE like libopencm3 does, nothing is wired to MISO
+uint16_t spi_read(uint32_t spi_base) {
+    sim_spi_t *spi = sim_spi_get(spi_base);
+    sim_access(SIM_APB1_ACCESS_PS);
+
+    if (!spi->rxne && spi->rx_pending) sim_advance(spi->rx_ps);
+    if (spi->rx_pending && sim_time_ps >= spi->rx_ps) sim_spi_receive(spi);
+    spi->rxne = false;
+    spi->ovr_dr_read = spi->ovr;
+    return 0xFFFF;
+}
+
+void spi_enable_rx_buffer_not_empty_interrupt(uint32_t spi_base) {
+    sim_access(SIM_APB1_ACCESS_PS);
+    sim_spi_get(spi_base)->rxne_interrupt = true;
+}
+
+void spi_disable_rx_buffer_not_empty_interrupt(uint32_t spi_base) {
+    sim_access(SIM_APB1_ACCESS_PS);
+    sim_spi_get(spi_base)->rxne_interrupt = false;
+}
+
+void spi_set_dff_8bit(uint32_t spi_base) {
+    sim_spi_set_dff(spi_base, false);
+}
+
+void spi_set_dff_16bit(uint32_t spi_base) {
+    sim_spi_set_dff(spi_base, true);
+}
+
+void spi_enable_tx_dma(uint32_t spi_base) {
+    sim_access(SIM_APB1_ACCESS_PS);
+    sim_spi_get(spi_base)->tx_dma = true;
+    for (size_t c = 0; c < 2; c++) {
+        for (size_t i = 0; i < 8; i++) sim_dma_try_start(&sim_dma[c][i]);
+    }
+}
+
+void spi_disable_tx_dma(uint32_t spi_base) {
+    sim_access(SIM_APB1_ACCESS_PS);
+    sim_spi_get(spi_base)->tx_dma = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////// DMA ///
+
+volatile uint32_t *sim_dma_ifcr(uint32_t dma, bool high) {
+    (void) dma;
+    (void) high;
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_ifcr_scratch = 0;
+    return &sim_dma_ifcr_scratch;
+}
+
+void dma_stream_reset(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    memset(sim_dma_get(dma, stream), 0, sizeof(sim_dma_stream_t));
+}
+
+void dma_set_transfer_mode(uint32_t dma, uint8_t stream, uint32_t direction) {
+    (void) direction;
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream);
+}
+
+void dma_set_peripheral_size(uint32_t dma, uint8_t stream, uint32_t peripheral_size) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream);
+    if (peripheral_size != DMA_SxCR_PSIZE_16BIT) sim_protocol_error("only 16-bit DMA peripheral size is modelled");
+}
+
+void dma_set_memory_size(uint32_t dma, uint8_t stream, uint32_t memory_size) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream);
+    if (memory_size != DMA_SxCR_MSIZE_16BIT) sim_protocol_error("only 16-bit DMA memory size is modelled");
+}
+
+void dma_enable_memory_increment_mode(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->memory_increment = true;
+}
+
+void dma_disable_memory_increment_mode(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->memory_increment = false;
+}
+
+void dma_disable_peripheral_increment_mode(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream);
+}
+
+void dma_enable_transfer_complete_interrupt(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->tc_interrupt = true;
+}
+
+void dma_disable_transfer_complete_interrupt(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->tc_interrupt = false;
+}
+
+void dma_enable_fifo_mode(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream);
+}
+
+void dma_set_fifo_threshold(uint32_t dma, uint8_t stream, uint32_t threshold) {
+    (void) threshold;
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream);
+}
+
+void dma_set_priority(uint32_t dma, uint8_t stream, uint32_t prio) {
+    (void) prio;
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream);
+}
+
+void dma_channel_select(uint32_t dma, uint8_t stream, uint32_t channel) {
+    (void) channel;
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream);
+}
+
+void dma_set_peripheral_address(uint32_t dma, uint8_t stream, uint32_t address) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->par = address;
+}
+
+void dma_set_memory_address(uint32_t dma, uint8_t stream, uint32_t address) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->m0ar = address;
+}
+
+void dma_set_memory_address_1(uint32_t dma, uint8_t stream, uint32_t address) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->m1ar = address;
+}
+
+void dma_set_number_of_data(uint32_t dma, uint8_t stream, uint16_t number) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_stream_t *s = sim_dma_get(dma, stream);
+
+    // NDTR is read-only while the stream is enabled (RM0368 9.5.6)
+    if (s->enabled) {
+        sim_protocol_error("NDTR written while the DMA stream is enabled");
+        return;
+    }
+    s->ndtr = number;
+    s->ndtr_reload = number;
+}
+
+void dma_enable_double_buffer_mode(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->double_buffer = true;
+}
+
+void dma_disable_double_buffer_mode(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->double_buffer = false;
+}
+
+void dma_enable_stream(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_stream_t *s = sim_dma_get(dma, stream);
+
+    s->enabled = true;
+    s->current_target = false;
+    sim_stats.dma_transfers++;
+    sim_dma_try_start(s);
+}
+
+void dma_disable_stream(uint32_t dma, uint8_t stream) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_stream_t *s = sim_dma_get(dma, stream);
+
+    if (s->running) sim_protocol_error("DMA stream disabled mid-transfer");
+    s->enabled = false;
+    s->running = false;
+}
+
+bool dma_get_interrupt_flag(uint32_t dma, uint8_t stream, uint32_t interrupts) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    return (sim_dma_get(dma, stream)->flags & interrupts) != 0;
+}
+
+void dma_clear_interrupt_flags(uint32_t dma, uint8_t stream, uint32_t interrupts) {
+    sim_access(SIM_AHB_ACCESS_PS);
+    sim_dma_get(dma, stream)->flags &= ~interrupts;
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "display.h"
+#include "display_p.h"
+#include "sim.h"
+
+extern TaskHandle_t hDisplayTask;
+
+////////////////////////////////////////////////////////////////////////////////// INTERNAL ///
+
+// Run the display task until its command ring is empty
+void sim_display_pump(void) {
+    while (_display_compose());
+}
+
+void sim_display_start(void) {
+    if ((uintptr_t) &sim_stats > UINT32_MAX) {
+        fprintf(stderr, "sim: static data above 4 GiB, link with -no-pie\n");
+        exit(EXIT_FAILURE);
+    }
+
+    display_setup();
+    sim_current_task = hDisplayTask;
+    sim_idle_hook = sim_display_pump;
+
+    _display_init();
+    sim_reset_stats();
+}
+
+static void sim_print_stats(const char *name) {
+    printf("%s: spi_bytes=%llu dma_transfers=%llu solid_pixels=%llu pixels_written=%llu pixels_discarded=%llu protocol_errors=%llu\n",
+        name,
+        (unsigned long long) sim_stats.spi_bytes,
+        (unsigned long long) sim_stats.dma_transfers,
+        (unsigned long long) sim_stats.dma_items_fixed,
+        (unsigned long long) sim_stats.pixels_written,
+        (unsigned long long) sim_stats.pixels_discarded,
+        (unsigned long long) sim_stats.protocol_errors
+    );
+}
+
+// Same screen as the controller task draws after boot
+static void sim_render_boot_screen(void) {
+    display_fill_screen(COLOR_GREEN);
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, 0, L"Hellow");
+    display_draw_text(&fira_code, COLOR_WHITE, COLOR_BLACK, 0, fira_code.height, L"World!");
+    sim_display_pump();
+}
+
+static int sim_usage(const char *program) {
+    fprintf(stderr, "usage: %s render <file.png>\n", program);
+    fprintf(stderr, "       %s bench [suite]\n", program);
+    return EXIT_FAILURE;
+}
+
+///////////////////////////////////////////////////////////////////////////////////// ENTRY ///
+
+int main(int argc, char **argv) {
+    if (argc < 2) return sim_usage(argv[0]);
+
+    if (strcmp(argv[1], "render") == 0 && argc == 3) {
+        sim_display_start();
+        sim_render_boot_screen();
+        sim_print_stats("boot_screen");
+        if (!sim_write_png(argv[2])) {
+            fprintf(stderr, "sim: can't write '%s'\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (strcmp(argv[1], "bench") == 0 && argc <= 3) {
+        sim_display_start();
+        return sim_bench(argc == 3 ? argv[2] : NULL);
+    }
+
+    return sim_usage(argv[0]);
+}
+
+// Firmware asserts end the simulation
+void __assert(const char *file, const int line, char *failedexpr) {
+    fprintf(stderr, "%s:%d: %s\n", file, line, failedexpr != NULL ? failedexpr : "assertion failed");
+    abort();
+}
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+
+// Minimal PNG encoder: 8-bit RGB, no filtering, deflate "stored" blocks.
+// Files are larger than they need to be but there is no zlib dependency.
+
+static uint32_t sim_crc_table[256];
+
+static void sim_crc_init(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        sim_crc_table[n] = c;
+    }
+}
+
+static uint32_t sim_crc(uint32_t crc, const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) crc = sim_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void sim_put_u32(uint8_t *out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+static void sim_write_chunk(FILE *file, const char *type, const uint8_t *data, size_t length) {
+    uint8_t header[8];
+    uint8_t footer[4];
+
+    sim_put_u32(header, length);
+    for (int i = 0; i < 4; i++) header[4 + i] = type[i];
+
+    uint32_t crc = sim_crc(0xFFFFFFFFU, &header[4], 4);
+    crc = sim_crc(crc, data, length) ^ 0xFFFFFFFFU;
+    sim_put_u32(footer, crc);
+
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(data, 1, length, file);
+    fwrite(footer, 1, sizeof(footer), file);
+}
+
+bool sim_write_png(const char *path) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    const size_t stride = 1 + SIM_PANEL_WIDTH * 3;
+    const size_t raw_size = stride * SIM_PANEL_HEIGHT;
+    const size_t blocks = (raw_size + 0xFFFF - 1) / 0xFFFF;
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+
+    uint8_t *raw = malloc(raw_size);
+    uint8_t *zlib = malloc(2 + raw_size + blocks * 5 + 4);
+    if (raw == NULL || zlib == NULL) {
+        free(raw);
+        free(zlib);
+        fclose(file);
+        return false;
+    }
+
+    // Expand RGB565 to RGB888 with bit replication, as the panel shows it
+    for (size_t y = 0; y < SIM_PANEL_HEIGHT; y++) {
+        uint8_t *row = &raw[y * stride];
+        *row++ = 0;
+        for (size_t x = 0; x < SIM_PANEL_WIDTH; x++) {
+            uint16_t color = sim_st7789_shown_pixel(x, y);
+            uint8_t r = (color >> 11) & 0x1F;
+            uint8_t g = (color >> 5) & 0x3F;
+            uint8_t b = color & 0x1F;
+            *row++ = (r << 3) | (r >> 2);
+            *row++ = (g << 2) | (g >> 4);
+            *row++ = (b << 3) | (b >> 2);
+        }
+    }
+
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < raw_size; i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    size_t length = 0;
+    zlib[length++] = 0x78;
+    zlib[length++] = 0x01;
+    for (size_t offset = 0; offset < raw_size; offset += 0xFFFF) {
+        size_t size = raw_size - offset < 0xFFFF ? raw_size - offset : 0xFFFF;
+        zlib[length++] = offset + size == raw_size;
+        zlib[length++] = size & 0xFF;
+        zlib[length++] = size >> 8;
+        zlib[length++] = ~size & 0xFF;
+        zlib[length++] = (~size >> 8) & 0xFF;
+        for (size_t i = 0; i < size; i++) zlib[length++] = raw[offset + i];
+    }
+    sim_put_u32(&zlib[length], (b << 16) | a);
+    length += 4;
+
+    uint8_t ihdr[13];
+    sim_put_u32(&ihdr[0], SIM_PANEL_WIDTH);
+    sim_put_u32(&ihdr[4], SIM_PANEL_HEIGHT);
+    ihdr[8]  = 8;   // Bit depth
+    ihdr[9]  = 2;   // Truecolor
+    ihdr[10] = 0;   // Deflate
+    ihdr[11] = 0;   // Adaptive filtering
+    ihdr[12] = 0;   // No interlace
+
+    sim_crc_init();
+    fwrite(signature, 1, sizeof(signature), file);
+    sim_write_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+    sim_write_chunk(file, "IDAT", zlib, length);
+    sim_write_chunk(file, "IEND", NULL, 0);
+
+    free(raw);
+    free(zlib);
+    return fclose(file) == 0;
+}
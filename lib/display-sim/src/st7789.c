@@ -0,0 +1,252 @@
+#include <string.h>
+
+#include "sim.h"
+#include "st7789.h"
+
+// Byte-level model of the ST7789V serial interface: commands are latched with
+// DC low, parameters and pixel data with DC high, a CS rising edge aborts the
+// command in progress (ST7789V datasheet, 8.4 "Serial interface").
+
+uint16_t sim_framebuffer[SIM_PANEL_HEIGHT][SIM_PANEL_WIDTH];
+
+static struct {
+    bool selected;
+    uint8_t command;
+    size_t index;
+    uint8_t params[6];
+    uint8_t pixel_high;
+    uint16_t column_start;
+    uint16_t column_end;
+    uint16_t row_start;
+    uint16_t row_end;
+    uint16_t column;
+    uint16_t row;
+    uint16_t scroll_top;        // VSCRDEF top fixed area
+    uint16_t scroll_lines;      // VSCRDEF vertical scroll area
+    uint16_t scroll_start;      // VSCSAD
+    bool partial;               // PTLON until NORON
+    uint16_t partial_start;     // PTLAR
+    uint16_t partial_end;
+    bool idle;                  // IDMON until IDMOFF
+    bool tearing;               // TEON until TEOFF
+    bool scanning;              // From SLPOUT on
+    uint64_t scan_origin;       // Wire time of SLPOUT, frames start from it
+    bool written;               // The RAMWR in progress has written pixels
+    uint16_t written_top;       // ... to these rows
+    uint16_t written_bottom;
+} sim_panel = {
+    .command      = ST7789_NOP,
+    .column_end   = SIM_PANEL_WIDTH - 1,
+    .row_end      = SIM_PANEL_HEIGHT - 1,
+    .scroll_lines = SIM_PANEL_HEIGHT,
+    .partial_end  = SIM_PANEL_HEIGHT - 1,
+};
+
+// Writes to each GRAM pixel since the last stats reset, saturating
+static uint8_t sim_writes[SIM_PANEL_HEIGHT][SIM_PANEL_WIDTH];
+
+// Wire time of the first and the last pixel the RAMWR in progress wrote to each row
+static uint64_t sim_row_first[SIM_PANEL_HEIGHT];
+static uint64_t sim_row_last[SIM_PANEL_HEIGHT];
+
+static uint16_t sim_st7789_param(size_t index) {
+    return (sim_panel.params[2 * index] << 8) | sim_panel.params[2 * index + 1];
+}
+
+// GRAM row the panel shows on screen line y with the VSCRDEF/VSCSAD setup
+size_t sim_st7789_scanned_row(size_t y) {
+    size_t top = sim_panel.scroll_top;
+    size_t lines = sim_panel.scroll_lines;
+
+    if (y < top || y >= top + lines || sim_panel.scroll_start < top || sim_panel.scroll_start >= top + lines) return y;
+    return top + (sim_panel.scroll_start - top + y - top) % lines;
+}
+
+// Count the refreshes during the RAMWR that just ended that showed some of
+// its rows old and some new, or a row half written
+static void sim_st7789_check_tearing(void) {
+    if (!sim_panel.written || !sim_panel.scanning) return;
+    sim_panel.written = false;
+
+    uint64_t start = UINT64_MAX;
+    uint64_t end = 0;
+    for (size_t row = sim_panel.written_top; row <= sim_panel.written_bottom; row++) {
+        if (sim_row_last[row] == 0) continue;
+        if (sim_row_first[row] < start) start = sim_row_first[row];
+        if (sim_row_last[row] > end) end = sim_row_last[row];
+    }
+
+    uint64_t first = start > sim_panel.scan_origin ? (start - sim_panel.scan_origin) / SIM_PANEL_FRAME_PS : 0;
+    uint64_t last  = (end - sim_panel.scan_origin) / SIM_PANEL_FRAME_PS + 1;
+    for (uint64_t frame = first; frame <= last; frame++) {
+        bool old = false, new = false, torn = false;
+        for (size_t y = 0; y < SIM_PANEL_HEIGHT && !torn; y++) {
+            size_t row = sim_st7789_scanned_row(y);
+            if (row < sim_panel.written_top || row > sim_panel.written_bottom || sim_row_last[row] == 0) continue;
+
+            uint64_t scan = sim_panel.scan_origin + frame * SIM_PANEL_FRAME_PS + (SIM_PANEL_BLANK_LINES + y) * SIM_PANEL_LINE_PS;
+            if (scan >= sim_row_last[row]) {
+                new = true;
+            } else if (scan < sim_row_first[row]) {
+                old = true;
+            } else {
+                torn = true;
+            }
+            torn |= old && new;
+        }
+        if (torn) sim_stats.torn_frames++;
+    }
+
+    for (size_t row = sim_panel.written_top; row <= sim_panel.written_bottom; row++) sim_row_last[row] = 0;
+}
+
+// First TE rising edge after the given time
+uint64_t sim_st7789_next_te(uint64_t after_ps) {
+    if (!sim_panel.tearing || !sim_panel.scanning) return UINT64_MAX;
+    if (after_ps < sim_panel.scan_origin) return sim_panel.scan_origin;
+    return sim_panel.scan_origin + ((after_ps - sim_panel.scan_origin) / SIM_PANEL_FRAME_PS + 1) * SIM_PANEL_FRAME_PS;
+}
+
+static void sim_st7789_put_pixel(uint16_t color, uint64_t ps) {
+    if (sim_panel.column < SIM_PANEL_WIDTH && sim_panel.row < SIM_PANEL_HEIGHT) {
+        sim_framebuffer[sim_panel.row][sim_panel.column] = color;
+        sim_stats.pixels_written++;
+
+        uint8_t *writes = &sim_writes[sim_panel.row][sim_panel.column];
+        if (*writes > 0) sim_stats.pixels_overdrawn++;
+        if (*writes < UINT8_MAX) (*writes)++;
+
+        uint16_t row = sim_panel.row;
+        if (sim_row_last[row] == 0) sim_row_first[row] = ps;
+        sim_row_last[row] = ps;
+        if (!sim_panel.written || row < sim_panel.written_top) sim_panel.written_top = row;
+        if (!sim_panel.written || row > sim_panel.written_bottom) sim_panel.written_bottom = row;
+        sim_panel.written = true;
+    } else {
+        sim_stats.pixels_discarded++;
+    }
+
+    // The address counter wraps inside the window set by CASET/RASET
+    if (sim_panel.column++ >= sim_panel.column_end) {
+        sim_panel.column = sim_panel.column_start;
+        if (sim_panel.row++ >= sim_panel.row_end) {
+            sim_panel.row = sim_panel.row_start;
+        }
+    }
+}
+
+// Color the panel shows at screen position (x, y). Lines outside the partial
+// area are black, idle mode keeps the top bit of each channel (8 colors).
+uint16_t sim_st7789_shown_pixel(size_t x, size_t y) {
+    if (sim_panel.partial && (y < sim_panel.partial_start || y > sim_panel.partial_end)) return 0x0000;
+
+    uint16_t color = sim_framebuffer[sim_st7789_scanned_row(y)][x];
+    if (sim_panel.idle) color = ((color & 0x8000) ? 0xF800 : 0) | ((color & 0x0400) ? 0x07E0 : 0) | ((color & 0x0010) ? 0x001F : 0);
+    return color;
+}
+
+void sim_st7789_reset_writes(void) {
+    memset(sim_writes, 0, sizeof(sim_writes));
+}
+
+void sim_st7789_select(bool selected) {
+    sim_st7789_check_tearing();
+    sim_panel.selected = selected;
+    sim_panel.command  = ST7789_NOP;
+    sim_panel.index    = 0;
+}
+
+void sim_st7789_write(uint8_t byte, bool data, uint64_t ps) {
+    if (!sim_panel.selected) return;
+
+    if (!data) {
+        sim_st7789_check_tearing();
+        sim_panel.command = byte;
+        sim_panel.index   = 0;
+        switch (byte) {
+        case ST7789_RAMWR:
+            sim_stats.windows++;
+            sim_panel.column = sim_panel.column_start;
+            sim_panel.row    = sim_panel.row_start;
+            break;
+        case ST7789_PTLON:
+        case ST7789_NORON:
+            sim_panel.partial = byte == ST7789_PTLON;
+            break;
+        case ST7789_IDMON:
+        case ST7789_IDMOFF:
+            sim_panel.idle = byte == ST7789_IDMON;
+            break;
+        case ST7789_TEON:
+        case ST7789_TEOFF:
+            sim_panel.tearing = byte == ST7789_TEON;
+            break;
+        case ST7789_SLPOUT:
+            sim_panel.scanning    = true;
+            sim_panel.scan_origin = ps;
+            break;
+        default:
+            break;
+        }
+        return;
+    }
+
+    switch (sim_panel.command) {
+    case ST7789_CASET:
+    case ST7789_RASET:
+        if (sim_panel.index < 4) sim_panel.params[sim_panel.index++] = byte;
+        if (sim_panel.index == 4) {
+            uint16_t start = sim_st7789_param(0);
+            uint16_t end   = sim_st7789_param(1);
+            if (sim_panel.command == ST7789_CASET) {
+                sim_panel.column_start = start;
+                sim_panel.column_end   = end;
+            } else {
+                sim_panel.row_start = start;
+                sim_panel.row_end   = end;
+            }
+            sim_panel.index++;
+        }
+        break;
+
+    case ST7789_PTLAR:
+        if (sim_panel.index < 4) sim_panel.params[sim_panel.index++] = byte;
+        if (sim_panel.index == 4) {
+            sim_panel.partial_start = sim_st7789_param(0);
+            sim_panel.partial_end   = sim_st7789_param(1);
+            sim_panel.index++;
+        }
+        break;
+
+    case ST7789_VSCRDEF:
+        if (sim_panel.index < 6) sim_panel.params[sim_panel.index++] = byte;
+        if (sim_panel.index == 6) {
+            if (sim_st7789_param(0) + sim_st7789_param(1) + sim_st7789_param(2) != SIM_PANEL_HEIGHT) {
+                sim_protocol_error("VSCRDEF areas do not add up to the panel height");
+            }
+            sim_panel.scroll_top   = sim_st7789_param(0);
+            sim_panel.scroll_lines = sim_st7789_param(1);
+            sim_panel.index++;
+        }
+        break;
+
+    case ST7789_VSCSAD:
+        if (sim_panel.index < 2) sim_panel.params[sim_panel.index++] = byte;
+        if (sim_panel.index == 2) {
+            sim_panel.scroll_start = sim_st7789_param(0);
+            sim_panel.index++;
+        }
+        break;
+
+    case ST7789_RAMWR:
+        if (sim_panel.index++ & 1) {
+            sim_st7789_put_pixel((sim_panel.pixel_high << 8) | byte, ps);
+        } else {
+            sim_panel.pixel_high = byte;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
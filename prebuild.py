@@ -44,6 +44,8 @@ class GenerateFonts(object):
         source_header_path    = self.include.joinpath('fonts.in.h')
         self.fonts            = self.root / 'fonts'
         self.max_gliph_size    = 0
+        self.ascii_first       = 0x20
+        self.ascii_last        = 0x7E
 
         self.offset  = 0.03125
 
@@ -107,25 +109,50 @@ class GenerateFonts(object):
         with source_path.open('wt', encoding='utf-8', errors='ignore') as out:
             out.write(header)
 
+            # Glyphs are stored compressed, one after another
             pixmap = img.load()
-            rows = []
-            for y in range(img.height):
-                row = []
-                for x in range(img.width):
-                    row.append(f'0x{pixmap[x,y]:02X}')
-                rows.append('    ' + ', '.join(row))
-            
-            out.write('const uint8_t ' + snake_name + '_data[] = { \n' + ',\n'.join(rows) + '\n};\n\n')
+            data = []
+            offsets = []
+            offset = 0
+            for i, char in enumerate(chars):
+                alpha = [pixmap[x, y] for y in range(i * height, (i + 1) * height) for x in range(font_width)]
+                data.append(self.compress_gliph(alpha, font_width))
+                offsets.append(offset)
+                offset += len(data[-1])
+
+            raw_size = len(chars) * font_width * height
+            packed_size = sum(len(gliph) for gliph in data)
+            out.write(f'// {len(chars)} glyphs, {packed_size} bytes compressed, {raw_size} bytes as 8-bit alpha\n')
+            out.write('const uint8_t ' + snake_name + '_data[] = {\n')
+            for char, gliph, offset in zip(chars, data, offsets):
+                out.write(f'    // {char} @ 0x{offset:08x}, ink {gliph[2]}x{gliph[3]} at {gliph[0]},{gliph[1]}\n')
+                for start in range(0, len(gliph), 16):
+                    out.write('    ' + ' '.join(f'0x{byte:02X},' for byte in gliph[start:start + 16]) + '\n')
+            out.write('};\n\n')
         
-            next = 'NULL'
-            for i, ch in reversed(list(enumerate(chars))):
+            # Printable ASCII goes to a direct-index table, the rest to a
+            # table sorted by key for binary search.
+            ascii = ['NULL'] * (self.ascii_last - self.ascii_first + 1)
+            sparse = []
+            for i, ch in enumerate(chars):
                 wch = list(unpack('<I', ch.encode('utf-32le')))[0]
-                offset = i * font_width * height
-                name = f'{snake_name}_gliph_{i:03d}'
-                out.write(f'const gliph_t {name} = {{ .key = 0x{wch:04x}, .data = &{snake_name}_data[0x{offset:08x}], .next = {next} }}; /* {ch} */\n' )
-                next = f'&{name}'
+                pointer = f'&{snake_name}_data[0x{offsets[i]:08x}]'
+                if self.ascii_first <= wch <= self.ascii_last:
+                    ascii[wch - self.ascii_first] = pointer
+                else:
+                    sparse.append((wch, pointer, ch))
 
-            out.write(f'\nconst font_t {snake_name} = {{ .height = {height}, .width = {font_width}, .baseline = {baseline}, .gliph = {next} }};\n')
+            out.write(f'const uint8_t * const {snake_name}_ascii[] = {{\n')
+            for i, pointer in enumerate(ascii):
+                out.write(f'    {pointer + ",":<32}/* {chr(self.ascii_first + i)} */\n')
+            out.write('};\n\n')
+
+            out.write(f'const gliph_t {snake_name}_gliph[] = {{\n')
+            for wch, pointer, ch in sorted(sparse):
+                out.write(f'    {{ .key = 0x{wch:04x}, .data = {pointer} }}, /* {ch} */\n')
+            out.write('};\n')
+
+            out.write(f'\nconst font_t {snake_name} = {{ .height = {height}, .width = {font_width}, .baseline = {baseline}, .ascii = {snake_name}_ascii, .gliph = {snake_name}_gliph, .gliph_count = {len(sparse)} }};\n')
 
         # Appand data to `fonts.h`
         with self.header_path.open('at+', encoding='utf-8', errors='ignore') as out:
@@ -136,6 +163,56 @@ class GenerateFonts(object):
 
 
 
+    @staticmethod
+    def compress_gliph(alpha: List[int], width: int) -> List[int]:
+        # Ink box followed by its 4-bit alpha in byte tokens, see `fonts.in.h`:
+        #   00nnnnnn           n + 1 pixels of alpha 0
+        #   01nnnnnn           n + 1 pixels of alpha 15
+        #   1nnnnnnn <nibbles> n + 1 literal pixels, high nibble first
+        values = [(a * 15 + 127) // 255 for a in alpha]
+        height = len(values) // width
+        ink = [(x, y) for y in range(height) for x in range(width) if values[y * width + x]]
+        if not ink:
+            return [0, 0, 0, 0]
+
+        left   = min(x for x, _ in ink)
+        right  = max(x for x, _ in ink)
+        top    = min(y for _, y in ink)
+        bottom = max(y for _, y in ink)
+        values = [values[y * width + x] for y in range(top, bottom + 1) for x in range(left, right + 1)]
+        result = [left, top, right - left + 1, bottom - top + 1]
+        literal = []
+
+        def flush():
+            while literal:
+                chunk = literal[:128]
+                del literal[:128]
+                result.append(0x80 | (len(chunk) - 1))
+                if len(chunk) & 1:
+                    chunk = chunk + [0]
+                for i in range(0, len(chunk), 2):
+                    result.append((chunk[i] << 4) | chunk[i + 1])
+
+        i = 0
+        while i < len(values):
+            value = values[i]
+            run = 1
+            if value in (0, 15):
+                while i + run < len(values) and values[i + run] == value and run < 64:
+                    run += 1
+
+            # Short runs are cheaper as nibbles inside a literal
+            if value in (0, 15) and run >= 3:
+                flush()
+                result.append((0x00 if value == 0 else 0x40) | (run - 1))
+            else:
+                literal.extend(values[i:i + run])
+            i += run
+
+        flush()
+        return result
+
+
     def optimize_font_size(self, font_path: Path, height: int, chars: str, face:int):
 
         def error(x: float, font: str, height: int, chars: str, face:int):
@@ -187,5 +264,117 @@ class GenerateFonts(object):
 
         return width, baceline
 
+class GenerateImages(object):
+
+    # Pictures in `images/` and their format, None picks the one that takes
+    # the least flash: alpha for grayscale pictures, for color ones the
+    # narrowest palette that holds their colors, RGB565 when none does.
+    IMAGES = [
+        ('icon_heating', None),
+        ('icon_fan',     None),
+        ('icon_alarm',   None),
+    ]
+
+    FORMATS = ['INDEX1', 'INDEX2', 'INDEX4', 'INDEX8', 'RGB565', 'ALPHA']
+
+    def __init__(self) -> None:
+        self.include     = Path(env['PROJECT_INCLUDE_DIR'])         # type: ignore
+        self.sources     = Path(env['PROJECT_SRC_DIR'])             # type: ignore
+        self.root        = Path(env['PROJECT_DIR'])                 # type: ignore
+        self.images      = self.root / 'images'
+        header_path      = self.include.joinpath('images.h')
+        source_path      = self.sources.joinpath('images.c')
+
+        header = self.include.joinpath('images.in.h').read_text(encoding='utf-8', errors='ignore')
+        with header_path.open('wt', encoding='utf-8', errors='ignore') as out:
+            out.write('// This file is auto-generated, do not edit it by hand.\n')
+            out.write(f'// Generated {datetime.now(tz=timezone.utc)}\n\n')
+            out.write(header)
+            out.write('\n')
+            for name, _ in self.IMAGES:
+                out.write(f'extern const image_t {name};\n')
+
+        with source_path.open('wt', encoding='utf-8', errors='ignore') as out:
+            out.write('// This file is auto-generated, do not edit it by hand.\n')
+            out.write(f'// Generated {datetime.now(tz=timezone.utc)}\n\n')
+            out.write('#include "images.h"\n')
+            for name, format in self.IMAGES:
+                self.generate_image(out, name, format)
+
+
+    @staticmethod
+    def rgb565(pixel) -> int:
+        r, g, b = pixel[:3]
+        return (((r * 31 + 127) // 255) << 11) | (((g * 63 + 127) // 255) << 5) | ((b * 31 + 127) // 255)
+
+
+    def pick_format(self, img) -> str:
+        if img.mode in ('1', 'L'):
+            return 'ALPHA'
+
+        colors = len(set(self.rgb565(pixel) for pixel in img.convert('RGB').getdata()))
+        for index in range(4):
+            if colors <= 1 << (1 << index):
+                return self.FORMATS[index]
+        return 'RGB565'
+
+
+    def generate_image(self, out, name: str, format):
+        img = Image.open(self.images / f'{name}.png')
+        width, height = img.size
+        if format is None:
+            format = self.pick_format(img)
+
+        palette = []
+        if format == 'ALPHA':
+            # The ink box of the glyph coding has 8-bit sides
+            assert width <= 255 and height <= 255, f'{name}: alpha images are 255x255 at most'
+            data = GenerateFonts.compress_gliph(list(img.convert('L').getdata()), width)
+        elif format == 'RGB565':
+            data = [self.rgb565(pixel) for pixel in img.convert('RGB').getdata()]
+        else:
+            bits = 1 << self.FORMATS.index(format)
+            pixels = [self.rgb565(pixel) for pixel in img.convert('RGB').getdata()]
+            palette = sorted(set(pixels))
+            assert len(palette) <= 1 << bits, f'{name}: {len(palette)} colors do not fit {format}'
+
+            # Rows start on a byte boundary, most significant bits first
+            data = []
+            for y in range(height):
+                byte, used = 0, 0
+                for x in range(width):
+                    byte = (byte << bits) | palette.index(pixels[y * width + x])
+                    used += bits
+                    if used == 8:
+                        data.append(byte)
+                        byte, used = 0, 0
+                if used:
+                    data.append(byte << (8 - used))
+
+        size = len(data) * (2 if format == 'RGB565' else 1) + len(palette) * 2
+        out.write(f'\n// {name}: {width}x{height} {format.lower()}, {size} bytes, {width * height * 2} as RGB565\n')
+
+        if palette:
+            out.write(f'static const uint16_t {name}_palette[] = {{\n')
+            for start in range(0, len(palette), 8):
+                out.write('    ' + ' '.join(f'0x{color:04X},' for color in palette[start:start + 8]) + '\n')
+            out.write('};\n\n')
+
+        if format == 'RGB565':
+            out.write(f'static const uint16_t {name}_pixels[] = {{\n')
+            for start in range(0, len(data), 8):
+                out.write('    ' + ' '.join(f'0x{word:04X},' for word in data[start:start + 8]) + '\n')
+            pointer = f'(const uint8_t *) {name}_pixels'
+        else:
+            out.write(f'static const uint8_t {name}_data[] = {{\n')
+            for start in range(0, len(data), 16):
+                out.write('    ' + ' '.join(f'0x{byte:02X},' for byte in data[start:start + 16]) + '\n')
+            pointer = f'{name}_data'
+        out.write('};\n\n')
+
+        out.write(f'const image_t {name} = {{ .width = {width}, .height = {height}, .format = IMAGE_FORMAT_{format}, '
+                  f'.colors = {len(palette)}, .palette = {name + "_palette" if palette else "NULL"}, .data = {pointer} }};\n')
+
 
 GenerateFonts()
+GenerateImages()
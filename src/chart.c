@@ -0,0 +1,64 @@
+#include "chart.h"
+
+////////////////////////////////////////////////////////////////////////////////// INTERNAL ///
+
+static uint16_t _chart_column(const chart_t *chart, int32_t value) {
+    if (value <= chart->min) return 0;
+    if (value >= chart->max) return DISPLAY_WIDTH - 1;
+    return (int64_t) (value - chart->min) * (DISPLAY_WIDTH - 1) / (chart->max - chart->min);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////// API ///
+
+// Clear the area and make it the scroll area, the chart starts empty
+void chart_init(chart_t *chart, uint16_t top, uint16_t lines, int32_t min, int32_t max, uint16_t color, uint16_t back_color) {
+    configASSERT(lines > 0 && max > min);
+
+    chart->top        = top;
+    chart->lines      = lines;
+    chart->min        = min;
+    chart->max        = max;
+    chart->color      = color;
+    chart->back_color = back_color;
+    chart->line       = top;
+    chart->started    = false;
+
+    display_set_scroll_area(top, lines);
+    display_fill_rect(back_color, 0, DISPLAY_WIDTH - 1, top, top + lines - 1);
+    display_scroll(top);
+}
+
+// Draw the sample into the row of the oldest one and scroll that row to the
+// bottom. The row and the scroll are queued as one list, so a full ring loses
+// the whole sample and never shows a stale row.
+display_fence_t chart_add_sample(chart_t *chart, int32_t value) {
+    uint16_t column = _chart_column(chart, value);
+    uint16_t left   = chart->started ? min(column, chart->column) : column;
+    uint16_t right  = chart->started ? max(column, chart->column) : column;
+    uint16_t row    = chart->line;
+    uint16_t next   = row + 1 < chart->top + chart->lines ? row + 1 : chart->top;
+
+    display_list_begin(&chart->list);
+    if (left > 0) display_list_fill_rect(&chart->list, chart->back_color, 0, left - 1, row, row);
+    display_list_fill_rect(&chart->list, chart->color, left, right, row, row);
+    if (right < DISPLAY_WIDTH - 1) display_list_fill_rect(&chart->list, chart->back_color, right + 1, DISPLAY_WIDTH - 1, row, row);
+    display_list_scroll(&chart->list, next);
+
+    display_fence_t fence = display_list_submit(&chart->list);
+    if (fence != DISPLAY_FENCE_NONE) {
+        chart->line    = next;
+        chart->column  = column;
+        chart->started = true;
+    }
+    return fence;
+}
+
+// Give the whole screen back to normal drawing. Rows of the former scroll
+// area show up in GRAM order, the caller repaints them.
+void chart_release(chart_t *chart) {
+    (void) chart;
+    display_set_scroll_area(0, DISPLAY_HEIGHT);
+    display_scroll(0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////// END ///
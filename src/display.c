@@ -5,9 +5,20 @@
 
 
 TaskHandle_t hDisplayTask;
-QueueHandle_t hDisplayQueue;
-uint16_t display_dma_buffer[FONT_MAX_GLIPH_SIZE];
+SemaphoreHandle_t hDisplayRingData;
+SemaphoreHandle_t hDisplayRingSpace;
+SemaphoreHandle_t hDisplayRingLock;
+SemaphoreHandle_t hDisplayFenceDone;
+SemaphoreHandle_t hDisplayWake;
+uint16_t display_dma_buffer[2][FONT_MAX_GLIPH_SIZE];
+uint16_t display_fill_color;
 volatile size_t display_dma_pixels_to_transfer;
+volatile bool display_dma_release;
+uint16_t display_alpha_lut[FONT_ALPHA_MAX + 1];
+display_stats_t display_stats;
+bool display_compositor_bypass;
+volatile display_render_mode_t display_render_mode = DISPLAY_RENDER_MODE;
+volatile display_vsync_t display_vsync = DISPLAY_VSYNC;
 
 ////////////////////////////////////////////////////////////////////////////////// INTERNAL ///
 
@@ -66,7 +77,6 @@ static inline void _display_sleep_exit(void) {
     spi_write(DISPLAY_SPI, ST7789_SLPOUT);
     spi_clean_disable(DISPLAY_SPI);
     _display_set_cs_high();
-    vTaskDelay(500);
 }
 
 static inline void _display_sleep_enter(void) {
@@ -80,6 +90,221 @@ static inline void _display_sleep_enter(void) {
     vTaskDelay(500);
 }
 
+// After _display_init() the SPI stays enabled. Commands and their parameters
+// go out in 8-bit frames and pixels in 16-bit ones, the peripheral is stopped
+// only to switch between them while the bus is idle.
+//
+// The command phase of a transaction is queued with the DC level of every
+// byte and sent by the SPI interrupt one frame at a time. RXNE means a frame
+// has left the shift register, so the handler can change DC before the next
+// one, and the task sleeps on its notification instead of polling the bus.
+
+#define DISPLAY_SPI_DATA    0x0100      // The queued byte goes out with DC high
+
+static bool display_spi_16bit;
+static uint16_t display_spi_queue[16];
+static size_t display_spi_count;
+static volatile size_t display_spi_sent;
+static display_rect_t display_window = { UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX };
+
+// The bus must be idle, DFF may only change while SPE is clear
+static inline void _display_spi_frame_size(bool wide) {
+    if (display_spi_16bit == wide) return;
+
+    spi_disable(DISPLAY_SPI);
+    if (wide) {
+        spi_set_dff_16bit(DISPLAY_SPI);
+    } else {
+        spi_set_dff_8bit(DISPLAY_SPI);
+    }
+    spi_enable(DISPLAY_SPI);
+    display_spi_16bit = wide;
+}
+
+static inline void _display_queue_command(uint8_t command) {
+    display_spi_queue[display_spi_count++] = command;
+}
+
+static inline void _display_queue_byte(uint8_t byte) {
+    display_spi_queue[display_spi_count++] = DISPLAY_SPI_DATA | byte;
+}
+
+static inline void _display_queue_word(uint16_t word) {
+    display_spi_queue[display_spi_count++] = DISPLAY_SPI_DATA | (word >> 8);
+    display_spi_queue[display_spi_count++] = DISPLAY_SPI_DATA | (word & 0xFF);
+}
+
+// Put the next queued byte on the bus, the previous one must be out
+static inline void _display_spi_next(void) {
+    uint16_t item = display_spi_queue[display_spi_sent++];
+    if (item & DISPLAY_SPI_DATA) {
+        _display_set_data();
+    } else {
+        _display_set_command();
+    }
+    spi_write(DISPLAY_SPI, item & 0xFF);
+}
+
+// Send the queue from an idle bus and sleep until its last byte is out. DC
+// is left high, for the pixels of a RAMWR.
+static void _display_send_queue(void) {
+    _display_spi_frame_size(false);
+
+    // Pixel DMA only transmits, what it clocked in overran the RX buffer.
+    // Once its last frame is in, reading DR and then SR clears OVR, RXNE
+    // would not set again otherwise.
+    _display_wait_spi();
+    (void) SPI_DR(DISPLAY_SPI);
+    (void) SPI_SR(DISPLAY_SPI);
+
+    display_spi_sent = 0;
+    spi_enable_rx_buffer_not_empty_interrupt(DISPLAY_SPI);
+    _display_spi_next();
+
+    // The SPI interrupt gives the same notification as the DMA one
+    _display_wait_dma();
+    display_spi_count = 0;
+}
+
+// The panel refreshes GRAM top to bottom once per frame, a window written
+// while the scan crosses it shows for a frame half old and half new (tearing).
+// A paced window starts right after the scan has passed its top row and is at
+// most a slice tall, so the scan does not catch up with the write in the next
+// frame either. The frame start comes from the TE line, without edges it is
+// extrapolated with the last period.
+//
+// Without TE the scan is timed from the last known frame start, SLPOUT or
+// the last edge, and the period. Any error of the period adds up from there,
+// so a paced slice is at most a frame long and never waits more than one.
+
+static volatile uint32_t display_vsync_edge;        // Cycle count of a frame start
+static volatile uint32_t display_vsync_period = DISPLAY_FRAME_CYCLES;
+static volatile uint32_t display_vsync_deadline;    // The paced window in flight is due by then
+static volatile bool display_vsync_pending;
+static bool display_vsync_te;                       // TEON sent and the edges interrupt
+
+static inline uint32_t _display_cycles(void) {
+    return dwt_read_cycle_counter();
+}
+
+// Sleep through whole ticks, spin the rest on the cycle counter
+static void _display_delay_cycles(uint32_t cycles) {
+    const uint32_t tick = configCPU_CLOCK_HZ / configTICK_RATE_HZ;
+    uint32_t start = _display_cycles();
+
+    if (cycles > 2 * tick) vTaskDelay(cycles / tick - 1);
+    while (_display_cycles() - start < cycles);
+}
+
+// The panel scans from SLPOUT on, the frame start of the timer
+static inline void _display_vsync_phase(void) {
+    display_vsync_edge = _display_cycles();
+}
+
+static inline bool _display_vsync_paced(size_t width, size_t rows) {
+    return display_vsync != DISPLAY_VSYNC_OFF && width * rows >= DISPLAY_VSYNC_PIXELS;
+}
+
+// Rows of a window the given width wide that can be written between two
+// passes of the scan. The write is slower than the scan at full width.
+size_t _display_vsync_slice(size_t width, size_t rows) {
+    if (!_display_vsync_paced(width, rows)) return rows;
+
+    uint32_t line = display_vsync_period / DISPLAY_FRAME_LINES;
+    uint32_t row  = width * DISPLAY_PIXEL_CYCLES;
+    uint32_t gap  = row > line ? row - line : line - row;
+    size_t slice  = gap == 0 ? rows : max((display_vsync_period - 2 * line) / gap, 1);
+    if (display_vsync == DISPLAY_VSYNC_TIMER) slice = min(slice, max(display_vsync_period / row, 1));
+    return slice;
+}
+
+// Wait until GRAM rows [top, bottom] can be written without the scan crossing
+// the write, the window is width pixels wide
+void _display_vsync_wait(size_t width, size_t top, size_t bottom) {
+    size_t rows = bottom - top + 1;
+    if (!_display_vsync_paced(width, rows)) return;
+
+    uint32_t period = display_vsync_period;
+    uint32_t line   = period / DISPLAY_FRAME_LINES;
+    uint32_t row    = width * DISPLAY_PIXEL_CYCLES;
+    uint32_t slot   = (DISPLAY_FRAME_BLANK + top) * line;
+
+    // Time since the scan passed the top row has to leave the scan ahead of a
+    // faster write (early) and a slower write ahead of the next pass (late)
+    uint32_t ahead  = line > row ? rows * (line - row) : 0;
+    uint32_t behind = row > line ? rows * (row - line) : 0;
+    uint32_t early  = line + ahead;
+    uint32_t late   = behind + 2 * line < period ? period - line - behind : 0;
+
+    taskENTER_CRITICAL();
+    uint32_t now   = _display_cycles();
+    uint32_t phase = (now - display_vsync_edge) % period;
+    if (now - display_vsync_edge >= period) display_vsync_edge = now - phase;
+    taskEXIT_CRITICAL();
+
+    uint32_t offset = (phase + period - slot) % period;
+    uint32_t wait = 0;
+    if (offset < early || offset > max(early, late)) wait = (early + period - offset) % period;
+    if (wait > 0) _display_delay_cycles(wait);
+
+    uint32_t wait_us = (_display_cycles() - now) / (configCPU_CLOCK_HZ / 1000000);
+    display_stats.vsync_windows++;
+    display_stats.vsync_wait_us_max = max(display_stats.vsync_wait_us_max, wait_us);
+
+    // The last row has to be written before the scan reaches it again
+    display_vsync_deadline = now + wait - (offset + wait) % period + period + rows * line;
+    display_vsync_pending  = true;
+}
+
+// Called from the DMA ISR when the window ends
+static inline void _display_vsync_done(void) {
+    display_vsync_pending = false;
+    if ((int32_t) (_display_cycles() - display_vsync_deadline) > 0) display_stats.vsync_late++;
+}
+
+// Called before each batch is drawn. The panel only drives TE and the edges
+// only interrupt while TE paces the windows.
+void _display_vsync_update(void) {
+    bool wanted = display_vsync == DISPLAY_VSYNC_TE;
+    if (display_vsync_te == wanted) return;
+
+    display_set_cs_low();
+    if (wanted) {
+        _display_queue_command(ST7789_TEON);
+        _display_queue_byte(ST7789_TE_VBLANK);
+    } else {
+        _display_queue_command(ST7789_TEOFF);
+    }
+    _display_send_queue();
+    _display_set_cs_high();
+
+    if (wanted) {
+        exti_reset_request(DISPLAY_TE_EXTI);
+        exti_enable_request(DISPLAY_TE_EXTI);
+    } else {
+        exti_disable_request(DISPLAY_TE_EXTI);
+    }
+    display_vsync_te = wanted;
+}
+
+// Every primitive is trimmed to the clip before it opens a window, so nothing
+// past the panel or outside display_set_clip() reaches the bus and hidden
+// primitives send nothing at all. Task state, set by CLIP commands in order.
+static display_rect_t display_clip = { 0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1 };
+
+// False if nothing is left. A side computed below 0 wraps to a huge value and
+// leaves nothing either.
+static inline bool _display_clip_rect(size_t left, size_t right, size_t top, size_t bottom, const display_rect_t *clip, display_rect_t *rect) {
+    left   = max(left, (size_t) clip->left);
+    right  = min(right, (size_t) clip->right);
+    top    = max(top, (size_t) clip->top);
+    bottom = min(bottom, (size_t) clip->bottom);
+    if (left > right || top > bottom) return false;
+
+    *rect = (display_rect_t) { left, right, top, bottom };
+    return true;
+}
+
 void _display_set_window(size_t left, size_t right, size_t top, size_t bottom) {
     left   += DISPLAY_OFFSET_X;
     right  += DISPLAY_OFFSET_X;
@@ -87,108 +312,160 @@ void _display_set_window(size_t left, size_t right, size_t top, size_t bottom) {
     bottom += DISPLAY_OFFSET_Y;
  
     display_dma_pixels_to_transfer = (right - left + 1) * (bottom - top + 1); 
+    _display_vsync_wait(right - left + 1, top, bottom);
 
-    _display_set_command();
-    spi_set_dff_8bit(DISPLAY_SPI);
-    spi_enable(DISPLAY_SPI);
     display_set_cs_low();
-    spi_write(DISPLAY_SPI, ST7789_CASET);
-    _display_wait_spi();
-    
-    _display_set_data();
-    spi_set_dff_16bit(DISPLAY_SPI);
-    spi_write(DISPLAY_SPI, left);
-    _display_wait_spi();
-    spi_write(DISPLAY_SPI, right);
-    _display_wait_spi();
 
-    _display_set_command();
-    spi_set_dff_8bit(DISPLAY_SPI);
-    spi_enable(DISPLAY_SPI);
-    spi_write(DISPLAY_SPI, ST7789_RASET);
-    _display_wait_spi();
-    
-    _display_set_data();
-    spi_set_dff_16bit(DISPLAY_SPI);
-    spi_write(DISPLAY_SPI, top);
-    _display_wait_spi();
-    spi_write(DISPLAY_SPI, bottom);
-    _display_wait_spi();
+    // The panel keeps the address window, a side that did not change since
+    // the previous window is not sent again
+    if (left != display_window.left || right != display_window.right) {
+        _display_queue_command(ST7789_CASET);
+        _display_queue_word(left);
+        _display_queue_word(right);
+        display_window.left  = left;
+        display_window.right = right;
+    }
+    if (top != display_window.top || bottom != display_window.bottom) {
+        _display_queue_command(ST7789_RASET);
+        _display_queue_word(top);
+        _display_queue_word(bottom);
+        display_window.top    = top;
+        display_window.bottom = bottom;
+    }
 
-    _display_set_command();
-    spi_set_dff_8bit(DISPLAY_SPI);
-    spi_enable(DISPLAY_SPI);
-    spi_write(DISPLAY_SPI, ST7789_RAMWR);
-    _display_wait_spi();
-    _display_set_data();
+    _display_queue_command(ST7789_RAMWR);
+    _display_send_queue();
+    _display_spi_frame_size(true);
 }
 
-void _display_color_fill_dma(size_t left, size_t right, size_t top, size_t bottom, uint16_t color) {
-    display_dma_buffer[0] = color;  
-    
-    _display_set_window(left, right, top, bottom);
-
-    dma_set_memory_address(DISPLAY_DMA, DISPLAY_DMA_STREAM, (uint32_t) display_dma_buffer);
-    dma_disable_memory_increment_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-    dma_enable_transfer_complete_interrupt(DISPLAY_DMA, DISPLAY_DMA_STREAM); 
+// Start the stream for the next chunk of display_dma_pixels_to_transfer. NDTR
+// is read-only while the stream runs, so a window over 65535 pixels is sent
+// as several transfers and the ISR restarts the stream after each one.
+static inline void _display_dma_next(void) {
+    size_t chunk = min(display_dma_pixels_to_transfer, (size_t) 0x0000FFFF);
+    dma_set_number_of_data(DISPLAY_DMA, DISPLAY_DMA_STREAM, chunk);
+    display_dma_pixels_to_transfer -= chunk;
+    dma_enable_stream(DISPLAY_DMA, DISPLAY_DMA_STREAM);
+}
 
-    if (display_dma_pixels_to_transfer > 0x0000FFFF) {
-        dma_enable_double_buffer_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-        dma_set_memory_address_1(DISPLAY_DMA, DISPLAY_DMA_STREAM, (uint32_t) display_dma_buffer);
-        dma_set_number_of_data(DISPLAY_DMA, DISPLAY_DMA_STREAM, 0x0000FFFF);
-        display_dma_pixels_to_transfer -= 0x0000FFFF;
+// Kick the DMA for display_dma_pixels_to_transfer pixels into the open RAMWR.
+// With release set the ISR ends the write and raises CS on the last transfer,
+// otherwise the bus is left selected so the next chunk continues the window.
+// Only a fill repeats its word for more than one transfer.
+static void _display_dma_start(const uint16_t *source, bool increment, bool release) {
+    configASSERT(!increment || display_dma_pixels_to_transfer <= 0x0000FFFF);
+    display_dma_release = release;
+
+    dma_set_memory_address(DISPLAY_DMA, DISPLAY_DMA_STREAM, (uint32_t) source);
+    if (increment) {
+        dma_enable_memory_increment_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
     } else {
-        dma_disable_double_buffer_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-        dma_set_number_of_data(DISPLAY_DMA, DISPLAY_DMA_STREAM, display_dma_pixels_to_transfer);
-        display_dma_pixels_to_transfer = 0;
+        dma_disable_memory_increment_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
     }
-    
-    dma_enable_stream(DISPLAY_DMA, DISPLAY_DMA_STREAM);
+    dma_enable_transfer_complete_interrupt(DISPLAY_DMA, DISPLAY_DMA_STREAM);
 
-    spi_set_dff_16bit(DISPLAY_SPI);
+    _display_dma_next();
     spi_enable_tx_dma(DISPLAY_SPI);
+}
 
-    // Nonblocking wait for dma transfer complete
-    xTaskNotifyWait(0, 0, NULL, portMAX_DELAY);
+void _display_color_fill_dma(size_t left, size_t right, size_t top, size_t bottom, uint16_t color) {
+    // An empty window would start the DMA with NDTR = 0 and never complete
+    display_rect_t rect;
+    if (!_display_clip_rect(left, right, top, bottom, &display_clip, &rect)) return;
+    left   = rect.left;
+    right  = rect.right;
+    top    = rect.top;
+    bottom = rect.bottom;
+
+    // Fills read a single word of their own, so they never disturb a glyph
+    // that is being prepared in one of the ping-pong buffers.
+    display_fill_color = color;  
+
+    // Paced fills taller than a slice go out one slice per pass of the scan
+    size_t slice = _display_vsync_slice(right - left + 1, bottom - top + 1);
+    for (; top <= bottom; top += slice) {
+        _display_set_window(left, right, top, min(bottom, top + slice - 1));
+        _display_dma_start(&display_fill_color, false, true);
+        _display_wait_dma();
+    }
 }
 
 void _display_fill_screen_dma(uint16_t color) {
-    _display_color_fill_dma(0, DISPLAY_WIDTH, 0, DISPLAY_HEIGHT, color);
+    _display_color_fill_dma(0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1, color);
 }
 
-void _display_copy_dma(size_t left, size_t right, size_t top, size_t bottom) {
+// Start sending the buffer to the window and return while the DMA runs.
+// The buffer must stay untouched until _display_wait_dma() returns.
+void _display_copy_dma_start(const uint16_t *buffer, size_t left, size_t right, size_t top, size_t bottom) {
     _display_set_window(left, right, top, bottom);
+    _display_dma_start(buffer, true, true);
+}
 
-    dma_set_memory_address(DISPLAY_DMA, DISPLAY_DMA_STREAM, (uint32_t) display_dma_buffer);
-    dma_enable_memory_increment_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-    dma_enable_transfer_complete_interrupt(DISPLAY_DMA, DISPLAY_DMA_STREAM);
+void _display_wait_dma(void) {
+    // Nonblocking wait for dma transfer complete
+    xTaskNotifyWait(0, 0, NULL, portMAX_DELAY);
+}
 
-    if (display_dma_pixels_to_transfer > 0x0000FFFF) {
-        dma_enable_double_buffer_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-        dma_set_memory_address_1(DISPLAY_DMA, DISPLAY_DMA_STREAM, (uint32_t) display_dma_buffer);
-        dma_set_number_of_data(DISPLAY_DMA, DISPLAY_DMA_STREAM, 0x0000FFFF);
-        display_dma_pixels_to_transfer -= 0x0000FFFF;
-    } else {
-        dma_disable_double_buffer_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-        dma_set_number_of_data(DISPLAY_DMA, DISPLAY_DMA_STREAM, display_dma_pixels_to_transfer);
-        display_dma_pixels_to_transfer = 0;
-    }
-    
-    dma_enable_stream(DISPLAY_DMA, DISPLAY_DMA_STREAM);
+void _display_copy_dma(const uint16_t *buffer, size_t left, size_t right, size_t top, size_t bottom) {
+    if (left > right || top > bottom) return;
 
-    spi_set_dff_16bit(DISPLAY_SPI);
-    spi_enable_tx_dma(DISPLAY_SPI);
+    _display_copy_dma_start(buffer, left, right, top, bottom);
+    _display_wait_dma();
+}
 
-    // Nonblocking wait for dma transfer complete
-    xTaskNotifyWait(0, 0, NULL, portMAX_DELAY);
+// Send a command with 16-bit parameters, e.g. VSCRDEF
+void _display_write_words(uint8_t command, const uint16_t *words, size_t count) {
+    configASSERT(1 + 2 * count <= sizeof(display_spi_queue) / sizeof(display_spi_queue[0]));
+
+    display_set_cs_low();
+    _display_queue_command(command);
+    for (size_t i = 0; i < count; i++) _display_queue_word(words[i]);
+    _display_send_queue();
+    _display_set_cs_high();
+}
+
+// Parts of a rectangle in the order they are sent: top side, left side,
+// interior, right side, bottom side. The middle three share their rows, so
+// only CASET changes between them. Parts never overlap, sides thicker than
+// half the rectangle meet in the middle. Returns the parts that are not empty.
+size_t _display_rect_parts(const draw_rect_t *rect, display_rect_t *parts, uint16_t *colors) {
+    int32_t left   = rect->left;
+    int32_t right  = rect->right;
+    int32_t top    = rect->top;
+    int32_t bottom = rect->bottom;
+    if (left > right || top > bottom) return 0;
+
+    int32_t inner_left   = min(left + rect->border, right + 1);
+    int32_t inner_right  = max(right - rect->border, inner_left - 1);
+    int32_t inner_top    = min(top + rect->border, bottom + 1);
+    int32_t inner_bottom = max(bottom - rect->border, inner_top - 1);
+
+    const int32_t bounds[5][4] = {
+        { left,            right,          top,              inner_top - 1  },
+        { left,            inner_left - 1, inner_top,        inner_bottom   },
+        { inner_left,      inner_right,    inner_top,        inner_bottom   },
+        { inner_right + 1, right,          inner_top,        inner_bottom   },
+        { left,            right,          inner_bottom + 1, bottom         },
+    };
+
+    size_t count = 0;
+    for (size_t i = 0; i < 5; i++) {
+        if (bounds[i][0] > bounds[i][1] || bounds[i][2] > bounds[i][3]) continue;
+        parts[count]  = (display_rect_t) { bounds[i][0], bounds[i][1], bounds[i][2], bounds[i][3] };
+        colors[count] = i == 2 ? rect->color : rect->border_color;
+        count++;
+    }
+    return count;
 }
 
-void _display_draw_rect(uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t fore_color, uint16_t border_color) {
-    _display_color_fill_dma(left  + 1, right-1  , top    - 1, bottom + 1, fore_color  );
-    _display_color_fill_dma(left     , right    , top       , top    - 1, border_color);
-    _display_color_fill_dma(left     , left  + 1, top    - 1, bottom + 1, border_color);
-    _display_color_fill_dma(right - 1, right    , top    - 1, bottom + 1, border_color);
-    _display_color_fill_dma(left     , right    , bottom    , bottom + 1, border_color);
+void _display_draw_rect(const draw_rect_t *rect) {
+    display_rect_t parts[5];
+    uint16_t colors[5];
+
+    size_t count = _display_rect_parts(rect, parts, colors);
+    for (size_t i = 0; i < count; i++) {
+        _display_color_fill_dma(parts[i].left, parts[i].right, parts[i].top, parts[i].bottom, colors[i]);
+    }
 }
 
 uint16_t _mix_colors(uint16_t fore_color, uint16_t back_color, uint8_t alpha) {
@@ -212,166 +489,874 @@ uint16_t _mix_colors(uint16_t fore_color, uint16_t back_color, uint8_t alpha) {
     return PACK_RGB565(result_r, result_g, result_b);
 }
 
-void _display_draw_text(const font_t *font, uint16_t left, uint16_t top, uint16_t fore_color, uint16_t back_color, wchar_t *text, size_t length) {
-    // TODO: Add bounds checks
-    for (size_t i = 0; i < length; i++) {
-        if (text == NULL) break;
-        wchar_t wch = *text++;
-        
-        // Copy data to dma buffer and colorize
-        const uint8_t *data = font_gliph(font, wch);
-        size_t size = font->height * font->width;
-        for (size_t j = 0; j < size ; j++) {
-            display_dma_buffer[j] = _mix_colors(fore_color, back_color, data[j]);
-        }
-
-        _display_copy_dma(left, left + font->width - 1, top, top + font-> height - 1);
-        left += font->width;
+// Fill display_alpha_lut with every blend of the color pair. The table is kept
+// between commands, so redrawing text in the same colors skips the rebuild.
+//
+// Text, shapes and alpha images all blend one color over a known back color
+// in 16 steps; the panel can't be read back, so there is no other background
+// to blend over. A lookup per pixel is cheaper than any per-pixel blend,
+// packed or not, and gives exactly the pixels of _mix_colors().
+void _display_build_alpha_lut(uint16_t fore_color, uint16_t back_color) {
+    static bool valid = false;
+    static uint16_t lut_fore_color;
+    static uint16_t lut_back_color;
+
+    if (valid && lut_fore_color == fore_color && lut_back_color == back_color) return;
+
+    for (size_t alpha = 0; alpha <= FONT_ALPHA_MAX; alpha++) {
+        display_alpha_lut[alpha] = _mix_colors(fore_color, back_color, alpha * 0x11);
     }
+
+    lut_fore_color = fore_color;
+    lut_back_color = back_color;
+    valid = true;
 }
 
-/////////////////////////////////////////////////////////////////////////////////////// END ///
+// Decode the next pixels of a glyph straight to colors through the alpha LUT
+void _display_decode_gliph(gliph_decoder_t *decoder, uint16_t *buffer, size_t pixels) {
+    while (pixels > 0) {
+        if (decoder->count == 0) {
+            uint8_t token = *decoder->data++;
+            decoder->token = token;
+            decoder->count = (token & ((token & FONT_TOKEN_LITERAL) ? FONT_LITERAL_MASK : FONT_RUN_MASK)) + 1;
+            decoder->low   = false;
+        }
 
-static inline void display_set_backlight(uint32_t value) {
-    if (value) {
-        gpio_set(DISPLAY_BL_PORT, DISPLAY_BL_PIN);
-    } else {
-        gpio_clear(DISPLAY_BL_PORT, DISPLAY_BL_PIN);
+        size_t count = min((size_t) decoder->count, pixels);
+        decoder->count -= count;
+        pixels -= count;
+
+        if (decoder->token & FONT_TOKEN_LITERAL) {
+            const uint8_t *data = decoder->data;
+            bool low = decoder->low;
+            for (; count > 0; count--) {
+                if (low) {
+                    *buffer++ = display_alpha_lut[*data++ & 0x0F];
+                } else {
+                    *buffer++ = display_alpha_lut[*data >> 4];
+                }
+                low = !low;
+            }
+
+            // Odd literals leave the low nibble of their last byte unused
+            if (decoder->count == 0 && low) data++;
+            decoder->data = data;
+            decoder->low  = low;
+        } else {
+            uint16_t color = display_alpha_lut[(decoder->token & FONT_TOKEN_FULL) ? FONT_ALPHA_MAX : 0];
+            for (; count > 0; count--) *buffer++ = color;
+        }
     }
 }
 
-// void display_draw_pixel(uint16_t x, uint16_t y, uint16_t color) {    
-//     if (x >= DISPLAY_WIDTH)  ASSERT("X must be in range 0..DISPLAY_WIDTH-1");    
-//     if (y >= DISPLAY_HEIGHT) ASSERT("Y must be in range 0..DISPLAY_HEIGHT-1");
+// Advance the decoder like _display_decode_gliph() without producing pixels
+void _display_skip_gliph(gliph_decoder_t *decoder, size_t pixels) {
+    while (pixels > 0) {
+        if (decoder->count == 0) {
+            uint8_t token = *decoder->data++;
+            decoder->token = token;
+            decoder->count = (token & ((token & FONT_TOKEN_LITERAL) ? FONT_LITERAL_MASK : FONT_RUN_MASK)) + 1;
+            decoder->low   = false;
+        }
 
-//     display_set_window(x, y, x, y);
-//     display_color_fill(color, 1);
-// }
+        size_t count = min((size_t) decoder->count, pixels);
+        decoder->count -= count;
+        pixels -= count;
 
-static inline void display_init_gpio(void) {
+        if (decoder->token & FONT_TOKEN_LITERAL) {
+            size_t nibbles = count + decoder->low;
+            decoder->data += nibbles / 2;
+            decoder->low   = nibbles & 1;
+            if (decoder->count == 0 && decoder->low) decoder->data++;
+        }
+    }
+}
 
-    // Data / Command
-    gpio_mode_setup(DISPLAY_DC_PORT, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DISPLAY_DC_PIN);
-    gpio_set_output_options(DISPLAY_DC_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_DC_PIN);
+void _display_gliph_decoder_init(gliph_decoder_t *decoder, const uint8_t *data) {
+    *decoder = (gliph_decoder_t) { 0 };
+    if (data == NULL) return;
 
-    // Backlight
-    gpio_mode_setup(DISPLAY_BL_PORT, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DISPLAY_BL_PIN);
-    gpio_set_output_options(DISPLAY_BL_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_BL_PIN);
+    decoder->box  = *(const gliph_box_t *) data;
+    decoder->data = data + sizeof(gliph_box_t);
+}
 
-    // Reset
-    gpio_set(DISPLAY_RST_PORT, DISPLAY_RST_PIN);
-    gpio_mode_setup(DISPLAY_RST_PORT, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DISPLAY_RST_PIN);
-    gpio_set_output_options(DISPLAY_RST_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_RST_PIN);
+// One row of a glyph cell. Only the ink box is decoded, the margins around it
+// and characters missing from the font (e.g. space) are plain background.
+static inline void _display_render_gliph_row(uint16_t *buffer, const font_t *font, gliph_decoder_t *decoder, size_t y, uint16_t back_color) {
+    const gliph_box_t *box = &decoder->box;
 
-    // SS
-    gpio_set(DISPLAY_SPI_PORT, DISPLAY_CS_PIN);
-    gpio_mode_setup(DISPLAY_SPI_PORT, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DISPLAY_CS_PIN);
-    gpio_set_output_options(DISPLAY_SPI_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_CS_PIN);
+    if (box->width > 0 && y >= box->top && y < (size_t) box->top + box->height) {
+        size_t right = box->left + box->width;
+        for (size_t x = 0; x < box->left; x++) buffer[x] = back_color;
+        _display_decode_gliph(decoder, &buffer[box->left], box->width);
+        for (size_t x = right; x < font->width; x++) buffer[x] = back_color;
+    } else {
+        for (size_t x = 0; x < font->width; x++) buffer[x] = back_color;
+    }
+}
 
-    // SPI
-    gpio_mode_setup(DISPLAY_SPI_PORT, GPIO_MODE_AF, GPIO_PUPD_NONE, DISPLAY_SCK_PIN | DISPLAY_MOSI_PIN);
-    gpio_set_af(DISPLAY_SPI_PORT, DISPLAY_SPI_GPIO_AF, DISPLAY_SCK_PIN | DISPLAY_MOSI_PIN);
-    gpio_set_output_options(DISPLAY_SPI_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_SCK_PIN | DISPLAY_MOSI_PIN);
+// Decode rows [row, row + rows) of every glyph of the run into one strip of
+// full-width scanlines
+void _display_render_text_strip(uint16_t *buffer, const font_t *font, gliph_decoder_t *decoders, size_t count, size_t row, size_t rows, uint16_t back_color) {
+    for (size_t y = row; y < row + rows; y++) {
+        for (size_t i = 0; i < count; i++) {
+            _display_render_gliph_row(buffer, font, &decoders[i], y, back_color);
+            buffer += font->width;
+        }
+    }
 }
 
-static inline void display_init_spi(void) {
-    spi_init_master(DISPLAY_SPI, SPI_CR1_BAUDRATE_FPCLK_DIV_2, SPI_CR1_CPOL_CLK_TO_0_WHEN_IDLE, SPI_CR1_CPHA_CLK_TRANSITION_1, SPI_CR1_DFF_8BIT, SPI_CR1_MSBFIRST);
+// Colorized glyphs kept between commands, keyed by font, character and
+// colors. An entry holds the ink rows of the cell at the full cell width, a
+// hit copies them into the strips of its run instead of decoding the glyph.
+// Entries are packed in the order they came in, evicting the least
+// recently used one moves the later ones down over its gap.
+//
+// A glyph is taken in on its second miss among the last misses, text that is
+// drawn once goes through the runs and does not flush the hot glyphs.
+
+#if DISPLAY_GLIPH_CACHE_SIZE > 0
+#define DISPLAY_GLIPH_CACHE_WORDS   (DISPLAY_GLIPH_CACHE_SIZE / sizeof(uint16_t))
+_Static_assert(DISPLAY_GLIPH_CACHE_WORDS <= UINT16_MAX + 1, "DISPLAY_GLIPH_CACHE_SIZE above 128 KiB overflows display_gliph_entry_t.offset");
+
+static uint16_t display_gliph_cache[DISPLAY_GLIPH_CACHE_WORDS];
+static size_t display_gliph_cache_used;
+static display_gliph_entry_t display_gliph_entries[DISPLAY_GLIPH_CACHE_ENTRIES];
+static size_t display_gliph_entry_count;
+static display_gliph_key_t display_gliph_missed[DISPLAY_GLIPH_CACHE_ENTRIES];
+static size_t display_gliph_missed_next;
+static uint32_t display_gliph_stamp;
+
+static inline bool _display_gliph_key_equal(const display_gliph_key_t *a, const display_gliph_key_t *b) {
+    return a->font == b->font && a->ch == b->ch && a->fore_color == b->fore_color && a->back_color == b->back_color;
 }
 
-static inline void display_init_dma(void) {
-    dma_stream_reset(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-    dma_set_transfer_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxCR_DIR_MEM_TO_PERIPHERAL);
-    dma_set_peripheral_size(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxCR_PSIZE_16BIT); 
-    dma_set_memory_size(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxCR_MSIZE_16BIT);
-    dma_disable_peripheral_increment_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-    dma_enable_transfer_complete_interrupt(DISPLAY_DMA, DISPLAY_DMA_STREAM);    
-    dma_enable_fifo_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-    dma_set_fifo_threshold(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxFCR_FTH_4_4_FULL);    
-    dma_set_priority(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxCR_PL_VERY_HIGH);
+static inline size_t _display_gliph_entry_words(const display_gliph_entry_t *entry) {
+    return entry->key.font->width * entry->rows;
+}
 
-    // dma_set_peripheral_address(DISPLAY_DMA, DISPLAY_DMA_STREAM, SPI_DR(DISPLAY_SPI));  
-    dma_set_peripheral_address(DISPLAY_DMA, DISPLAY_DMA_STREAM, 0x4000380C);  
-    nvic_enable_irq(NVIC_DMA1_STREAM4_IRQ);
+static void _display_gliph_evict(void) {
+    size_t lru = 0;
+    for (size_t i = 1; i < display_gliph_entry_count; i++) {
+        if (display_gliph_entries[i].used < display_gliph_entries[lru].used) lru = i;
+    }
+
+    size_t offset = display_gliph_entries[lru].offset;
+    size_t words = _display_gliph_entry_words(&display_gliph_entries[lru]);
+    memmove(&display_gliph_cache[offset], &display_gliph_cache[offset + words], (display_gliph_cache_used - offset - words) * sizeof(uint16_t));
+
+    for (size_t i = lru + 1; i < display_gliph_entry_count; i++) {
+        display_gliph_entries[i - 1] = display_gliph_entries[i];
+        display_gliph_entries[i - 1].offset -= words;
+    }
+    display_gliph_entry_count--;
+    display_gliph_cache_used -= words;
+    display_stats.gliph_cache_evictions++;
 }
+#endif
 
-static inline void display_set_color_mode(uint8_t mode) {
-    spi_set_dff_8bit(DISPLAY_SPI);
-    _display_set_command();
-    spi_enable(DISPLAY_SPI);
-    display_set_cs_low();
-    spi_write(DISPLAY_SPI, ST7789_COLMOD);
-    _display_wait_spi();
-    gpio_set(DISPLAY_DC_PORT, DISPLAY_DC_PIN);
-    spi_write(DISPLAY_SPI, mode);
-    spi_clean_disable(DISPLAY_SPI);
-    _display_set_cs_high();
-    vTaskDelay(10);
+// Cached glyph in the colors without counting or refreshing it, NULL if the
+// cache does not have it
+static const display_gliph_entry_t *_display_gliph_cache_find(const font_t *font, wchar_t ch, uint16_t fore_color, uint16_t back_color) {
+#if DISPLAY_GLIPH_CACHE_SIZE > 0
+    const display_gliph_key_t key = { font, ch, fore_color, back_color };
+
+    for (size_t i = 0; i < display_gliph_entry_count; i++) {
+        if (_display_gliph_key_equal(&display_gliph_entries[i].key, &key)) return &display_gliph_entries[i];
+    }
+#else
+    (void) font;
+    (void) ch;
+    (void) fore_color;
+    (void) back_color;
+#endif
+    return NULL;
 }
 
-static inline void display_set_memory_mode(uint8_t mode) {    
-    spi_set_dff_8bit(DISPLAY_SPI);
-    _display_set_command();
-    spi_enable(DISPLAY_SPI);
-    display_set_cs_low();
-    spi_write(DISPLAY_SPI, ST7789_MADCTL);
-    _display_wait_spi();
-    gpio_set(DISPLAY_DC_PORT, DISPLAY_DC_PIN);
-    spi_write(DISPLAY_SPI, mode);
-    spi_clean_disable(DISPLAY_SPI);
-    _display_set_cs_high();
-    vTaskDelay(10);
+// Row y of the cell from a cached glyph, NULL outside its ink rows
+static inline const uint16_t *_display_gliph_cache_row(const display_gliph_entry_t *entry, size_t y) {
+#if DISPLAY_GLIPH_CACHE_SIZE > 0
+    if (y < entry->top || y >= (size_t) entry->top + entry->rows) return NULL;
+    return &display_gliph_cache[entry->offset + (y - entry->top) * entry->key.font->width];
+#else
+    (void) entry;
+    (void) y;
+    return NULL;
+#endif
 }
 
-static inline void display_inverted(void) {
-    _display_set_command();
-    spi_set_dff_8bit(DISPLAY_SPI);
-    spi_enable(DISPLAY_SPI);
-    display_set_cs_low();
-    spi_write(DISPLAY_SPI, ST7789_INVON);
-    spi_clean_disable(DISPLAY_SPI);
-    _display_set_cs_high();
-    vTaskDelay(10);
+// Cached glyph in the colors, NULL if it has to be drawn from the font. The
+// entry stays valid until the next call.
+static const display_gliph_entry_t *_display_gliph_cache_get(const font_t *font, wchar_t ch, uint16_t fore_color, uint16_t back_color) {
+#if DISPLAY_GLIPH_CACHE_SIZE > 0
+    const display_gliph_key_t key = { font, ch, fore_color, back_color };
+    display_gliph_stamp++;
+
+    display_gliph_entry_t *hit = (display_gliph_entry_t *) _display_gliph_cache_find(font, ch, fore_color, back_color);
+    if (hit != NULL) {
+        hit->used = display_gliph_stamp;
+        display_stats.gliph_cache_hits++;
+        return hit;
+    }
+    display_stats.gliph_cache_misses++;
+
+    // A blank cell is a plain fill
+    gliph_decoder_t decoder;
+    _display_gliph_decoder_init(&decoder, font_gliph(font, ch));
+    size_t words = font->width * decoder.box.height;
+    if (decoder.box.width == 0 || words > DISPLAY_GLIPH_CACHE_WORDS) return NULL;
+
+    bool seen = false;
+    for (size_t i = 0; i < DISPLAY_GLIPH_CACHE_ENTRIES && !seen; i++) {
+        seen = _display_gliph_key_equal(&display_gliph_missed[i], &key);
+        if (seen) display_gliph_missed[i] = (display_gliph_key_t) { 0 };
+    }
+    if (!seen) {
+        display_gliph_missed[display_gliph_missed_next] = key;
+        display_gliph_missed_next = (display_gliph_missed_next + 1) % DISPLAY_GLIPH_CACHE_ENTRIES;
+        return NULL;
+    }
+
+    while (display_gliph_entry_count == DISPLAY_GLIPH_CACHE_ENTRIES || display_gliph_cache_used + words > DISPLAY_GLIPH_CACHE_WORDS) {
+        _display_gliph_evict();
+    }
+
+    display_gliph_entry_t *entry = &display_gliph_entries[display_gliph_entry_count++];
+    *entry = (display_gliph_entry_t) { key, display_gliph_cache_used, decoder.box.top, decoder.box.height, display_gliph_stamp };
+
+    _display_build_alpha_lut(fore_color, back_color);
+    _display_render_text_strip(&display_gliph_cache[entry->offset], font, &decoder, 1, entry->top, entry->rows, back_color);
+    display_gliph_cache_used += words;
+    return entry;
+#else
+    (void) font;
+    (void) ch;
+    (void) fore_color;
+    (void) back_color;
+    return NULL;
+#endif
 }
 
-static inline void display_normal(void) {
-    _display_set_command();
-    spi_set_dff_8bit(DISPLAY_SPI);
-    spi_enable(DISPLAY_SPI);
-    display_set_cs_low();
-    spi_write(DISPLAY_SPI, ST7789_NORON);
-    spi_clean_disable(DISPLAY_SPI);
-    _display_set_cs_high();
-    vTaskDelay(10);
+// Forget every cached glyph, e.g. to measure from a cold cache
+void _display_gliph_cache_reset(void) {
+#if DISPLAY_GLIPH_CACHE_SIZE > 0
+    display_gliph_entry_count = 0;
+    display_gliph_cache_used = 0;
+    memset(display_gliph_missed, 0, sizeof(display_gliph_missed));
+#endif
 }
 
-static inline void display_on(void) {
-    _display_set_command();
-    spi_set_dff_8bit(DISPLAY_SPI);
-    spi_enable(DISPLAY_SPI);
-    display_set_cs_low();
-    spi_write(DISPLAY_SPI, ST7789_DISPON);
-    spi_clean_disable(DISPLAY_SPI);
-    _display_set_cs_high();
-    vTaskDelay(10);
+// Rows [row, row + rows) of the run like _display_render_text_strip(), the
+// ink rows of cached glyphs are copied instead of decoded
+static void _display_render_run_strip(uint16_t *buffer, const font_t *font, gliph_decoder_t *decoders, const display_gliph_entry_t * const *cached, size_t count, size_t row, size_t rows, uint16_t back_color) {
+    for (size_t y = row; y < row + rows; y++) {
+        for (size_t i = 0; i < count; i++) {
+            if (cached[i] == NULL) {
+                _display_render_gliph_row(buffer, font, &decoders[i], y, back_color);
+            } else {
+                const uint16_t *pixels = _display_gliph_cache_row(cached[i], y);
+                if (pixels != NULL) memcpy(buffer, pixels, font->width * sizeof(uint16_t));
+                else for (size_t x = 0; x < font->width; x++) buffer[x] = back_color;
+            }
+            buffer += font->width;
+        }
+    }
 }
 
-static inline void display_init(void) {
-    display_init_spi();
-    display_init_gpio();
-    display_init_dma();
+// One window covers the whole run and is written with a single RAMWR. Rows
+// above and below the ink of every glyph are a solid background fill, the DMA
+// repeats one word for them. The rows between are produced in strips that fit
+// a ping-pong buffer: while the DMA sends one strip, the CPU decodes the next
+// one into the other buffer. Glyphs the cache has are copied from it.
+static void _display_draw_text_run(const font_t *font, uint16_t left, uint16_t top, uint16_t fore_color, uint16_t back_color, const wchar_t *text, size_t count) {
+    static gliph_decoder_t decoders[DISPLAY_TEXT_RUN];
+    static const display_gliph_entry_t *cached[DISPLAY_TEXT_RUN];
+    size_t ink_top = font->height;
+    size_t ink_bottom = 0;
+
+    // Taking a glyph in may move the entries found before it, they are only
+    // looked up again once the whole run went through the cache
+    for (size_t i = 0; i < count; i++) cached[i] = _display_gliph_cache_get(font, text[i], fore_color, back_color);
+
+    for (size_t i = 0; i < count; i++) {
+        if (cached[i] != NULL) cached[i] = _display_gliph_cache_find(font, text[i], fore_color, back_color);
+
+        if (cached[i] != NULL) {
+            ink_top    = min(ink_top, (size_t) cached[i]->top);
+            ink_bottom = max(ink_bottom, (size_t) cached[i]->top + cached[i]->rows);
+            continue;
+        }
 
-    _display_hard_reset();
-    _display_soft_reset();
-    _display_sleep_exit();
+        _display_gliph_decoder_init(&decoders[i], font_gliph(font, text[i]));
+        const gliph_box_t *box = &decoders[i].box;
+        if (box->width > 0) {
+            ink_top    = min(ink_top, (size_t) box->top);
+            ink_bottom = max(ink_bottom, (size_t) box->top + box->height);
+        }
+    }
 
-    nvic_enable_irq(NVIC_DMA1_STREAM4_IRQ);
-    nvic_enable_irq(NVIC_SPI2_IRQ);
+    // A run without any ink is one solid fill
+    if (ink_top > ink_bottom) ink_bottom = ink_top;
 
-    display_set_color_mode(ST7789_16bit | ST7789_RGB_65k);
+    size_t width = count * font->width;
+    size_t strip = max(FONT_MAX_GLIPH_SIZE / width, 1);
+    size_t current = 0;
+    size_t row = ink_top;
+    size_t rows = min(strip, ink_bottom - ink_top);
+
+    display_fill_color = back_color;
+    _display_set_window(left, left + width - 1, top, top + font->height - 1);
+
+    if (ink_top > 0) {
+        display_dma_pixels_to_transfer = ink_top * width;
+        _display_dma_start(&display_fill_color, false, ink_top == font->height);
+    }
+    if (rows > 0) _display_render_run_strip(display_dma_buffer[current], font, decoders, cached, count, row, rows, back_color);
+    if (ink_top > 0) _display_wait_dma();
+
+    while (rows > 0) {
+        size_t next = row + rows;
+        size_t next_rows = min(strip, ink_bottom - next);
+
+        display_dma_pixels_to_transfer = rows * width;
+        _display_dma_start(display_dma_buffer[current], true, next_rows == 0 && ink_bottom == font->height);
+
+        current ^= 1;
+        if (next_rows > 0) _display_render_run_strip(display_dma_buffer[current], font, decoders, cached, count, next, next_rows, back_color);
+
+        _display_wait_dma();
+        row = next;
+        rows = next_rows;
+    }
+
+    if (ink_bottom < font->height) {
+        display_dma_pixels_to_transfer = (font->height - ink_bottom) * width;
+        _display_dma_start(&display_fill_color, false, true);
+        _display_wait_dma();
+    }
+}
+
+// The text must be inside the clip, _display_execute() sends text that is cut
+// through the band renderer
+void _display_draw_text(const font_t *font, uint16_t left, uint16_t top, uint16_t fore_color, uint16_t back_color, const wchar_t *text, size_t length) {
+    if (text == NULL || length == 0) return;
+
+    _display_build_alpha_lut(fore_color, back_color);
+
+    while (length > 0) {
+        size_t count = min(length, DISPLAY_TEXT_RUN);
+        _display_draw_text_run(font, left, top, fore_color, back_color, text, count);
+        left   += count * font->width;
+        text   += count;
+        length -= count;
+    }
+}
+
+// Shapes are rasterized a row at a time into coverage, 0 to FONT_ALPHA_MAX in
+// sixteenths of a pixel, and only the covered runs are sent. A pixel at
+// distance d from the center of a circle of radius r is covered by
+// (r + 1 - d) * 16, so a radius of r spans 2r + 1 pixels like the aliased
+// circle would. Square roots are only taken for pixels on an edge.
+
+// Quarter wave of sin in Q14, one entry per degree
+static const int16_t display_sine[91] = {
+        0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+     2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+     5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+     8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+    12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+    16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+    16384,
+};
+
+// Edges of a disk or ring, radii in sixteenths of a pixel
+typedef struct {
+    int32_t outer;          // (radius + 1) * 16
+    int32_t inner;          // Same for the hole, below 0 without one
+} display_ring_t;
+
+// Zones of a ring in one row as the largest |dx| inside each, -1 if empty
+typedef struct {
+    int32_t dy2;
+    int32_t covered;        // Reached by the outer edge at all
+    int32_t solid;          // Fully inside the outer edge
+    int32_t partial;        // Not fully outside the hole
+    int32_t hole;           // Inside the hole
+} display_ring_row_t;
+
+static int32_t _display_sin(uint32_t degrees) {
+    degrees %= 360;
+    if (degrees <= 90)  return display_sine[degrees];
+    if (degrees <= 180) return display_sine[180 - degrees];
+    if (degrees <= 270) return -display_sine[degrees - 180];
+    return -display_sine[360 - degrees];
+}
+
+static uint32_t _display_isqrt(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > value) bit >>= 2;
+    for (; bit != 0; bit >>= 2) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+
+// Largest dx with 256 * (dx² + dy²) < edge², -1 if there is none
+static inline int32_t _display_ring_extent(int32_t edge, int32_t dy2) {
+    if (edge <= 0) return -1;
+    int32_t limit = (edge * edge - 1) / 256;
+    return limit < dy2 ? -1 : (int32_t) _display_isqrt(limit - dy2);
+}
+
+static void _display_ring_row(const display_ring_t *ring, int32_t dy, display_ring_row_t *row) {
+    row->dy2     = dy * dy;
+    row->covered = _display_ring_extent(ring->outer, row->dy2);
+    row->solid   = _display_ring_extent(ring->outer - 14, row->dy2);
+    row->partial = _display_ring_extent(ring->inner + 15, row->dy2);
+    row->hole    = _display_ring_extent(ring->inner + 1, row->dy2);
+}
+
+static inline uint8_t _display_ring_alpha(const display_ring_t *ring, const display_ring_row_t *row, int32_t dx) {
+    if (dx < 0) dx = -dx;
+    if (dx > row->covered || dx <= row->hole) return 0;
+    if (dx <= row->solid && dx > row->partial) return FONT_ALPHA_MAX;
+
+    int32_t distance = _display_isqrt(256 * (dx * dx + row->dy2));
+    int32_t alpha = min(ring->outer - distance, (int32_t) FONT_ALPHA_MAX);
+    if (ring->inner >= 0) alpha = min(alpha, distance - ring->inner);
+    return max(alpha, 0);
+}
+
+// Coverage by the half plane left of a side of the arc, from the cross
+// product in Q14 pixels
+static inline int32_t _display_side_alpha(int32_t cross) {
+    return min(max((cross >> 10) + 8, 0), (int32_t) FONT_ALPHA_MAX);
+}
+
+// Coverage of the pixels [left, right] of row y
+void _display_shape_alpha(const display_command_t *command, size_t y, size_t left, size_t right, uint8_t *alpha) {
+    display_ring_row_t row;
+
+    switch (command->id) {
+    case DISPLAY_COMMAND_ROUND_RECT: {
+        const round_rect_t *rect = &command->round_rect;
+        int32_t radius = min((int32_t) rect->radius, min(rect->right - rect->left, rect->bottom - rect->top) / 2);
+        const display_ring_t corner = { (radius + 1) * 16, -16 };
+
+        // Rows between the corners are solid
+        int32_t dy = (int32_t) y < rect->top + radius ? rect->top + radius - (int32_t) y : max((int32_t) y - (rect->bottom - radius), 0);
+        _display_ring_row(&corner, dy, &row);
+
+        for (size_t x = left; x <= right; x++) {
+            int32_t dx = (int32_t) x < rect->left + radius ? rect->left + radius - (int32_t) x : max((int32_t) x - (rect->right - radius), 0);
+            *alpha++ = _display_ring_alpha(&corner, &row, dx);
+        }
+        break;
+    }
+
+    case DISPLAY_COMMAND_DRAW_ARC: {
+        const draw_arc_t *arc = &command->draw_arc;
+        const display_ring_t ring = { (arc->radius + 1) * 16, ((int32_t) arc->radius - arc->thickness) * 16 };
+        int32_t dy = (int32_t) y - arc->y;
+        _display_ring_row(&ring, dy, &row);
+
+        // Sides from the center along start and end, the arc lies clockwise
+        // of the first and counterclockwise of the second. Up to half a turn
+        // it is inside both, beyond that inside either.
+        bool whole = arc->end >= arc->start + 360u;
+        bool wide  = arc->end > arc->start + 180u;
+        int32_t start_x = _display_sin(arc->start), start_y = -_display_sin(arc->start + 90);
+        int32_t end_x   = _display_sin(arc->end),   end_y   = -_display_sin(arc->end + 90);
+
+        for (size_t x = left; x <= right; x++) {
+            int32_t dx = (int32_t) x - arc->x;
+            uint8_t covered = _display_ring_alpha(&ring, &row, dx);
+            if (covered != 0 && !whole) {
+                int32_t after  = _display_side_alpha(start_x * dy - start_y * dx);
+                int32_t before = _display_side_alpha(dx * end_y - dy * end_x);
+                covered = min(covered, wide ? max(after, before) : min(after, before));
+            }
+            *alpha++ = covered;
+        }
+        break;
+    }
+
+    default:
+        memset(alpha, 0, right - left + 1);
+        break;
+    }
+}
+
+static void _display_shape_flush(display_rect_t *fill, bool *busy) {
+    if (fill->left > fill->right) return;
+
+    if (*busy) _display_wait_dma();
+    *busy = false;
+    _display_color_fill_dma(fill->left, fill->right, fill->top, fill->bottom, display_alpha_lut[FONT_ALPHA_MAX]);
+    *fill = (display_rect_t) { 1, 0, 0, 0 };
+}
+
+// Each covered run of a row goes out as a window of its own, blended with the
+// back color through the alpha LUT like a glyph. Runs are prepared in one
+// ping-pong buffer while the other one is on the bus, and solid runs over the
+// same columns on consecutive rows are joined into one fill.
+void _display_draw_shape(const display_command_t *command) {
+    static uint8_t alpha[DISPLAY_WIDTH];
+    display_rect_t area;
+
+    if (!_display_command_rect(command, &area) || !_display_clip_rect(area.left, area.right, area.top, area.bottom, &display_clip, &area)) return;
+
+    if (command->id == DISPLAY_COMMAND_ROUND_RECT) {
+        _display_build_alpha_lut(command->round_rect.color, command->round_rect.back_color);
+    } else {
+        _display_build_alpha_lut(command->draw_arc.color, command->draw_arc.back_color);
+    }
+
+    display_rect_t fill = { 1, 0, 0, 0 };
+    size_t current = 0;
+    bool busy = false;
+
+    for (size_t y = area.top; y <= area.bottom; y++) {
+        _display_shape_alpha(command, y, area.left, area.right, alpha);
+        bool filling = false;
+
+        for (size_t x = area.left; x <= area.right; ) {
+            if (alpha[x - area.left] == 0) {
+                x++;
+                continue;
+            }
+
+            size_t start = x;
+            bool solid = true;
+            for (; x <= area.right && alpha[x - area.left] != 0; x++) solid &= alpha[x - area.left] == FONT_ALPHA_MAX;
+
+            if (solid) {
+                if (fill.left != start || fill.right != x - 1 || fill.bottom + 1u != y) {
+                    _display_shape_flush(&fill, &busy);
+                    fill = (display_rect_t) { start, x - 1, y, y };
+                }
+                fill.bottom = y;
+                filling = true;
+                continue;
+            }
+
+            uint16_t *pixels = display_dma_buffer[current];
+            for (size_t i = start; i < x; i++) *pixels++ = display_alpha_lut[alpha[i - area.left]];
+
+            if (busy) _display_wait_dma();
+            _display_copy_dma_start(display_dma_buffer[current], start, x - 1, y, y);
+            busy = true;
+            current ^= 1;
+        }
+
+        if (!filling) _display_shape_flush(&fill, &busy);
+    }
+
+    _display_shape_flush(&fill, &busy);
+    if (busy) _display_wait_dma();
+}
+
+// Columns [left, right] of rows [row, row + rows) of the image as colors. The
+// decoder of an alpha image stands at the first of those rows and moves past
+// them, its box rows cut by the columns are skipped around them.
+static void _display_render_image_strip(uint16_t *buffer, const image_t *image, gliph_decoder_t *decoder, size_t left, size_t right, size_t row, size_t rows, uint16_t back_color) {
+    size_t width = right - left + 1;
+
+    switch (image->format) {
+    case IMAGE_FORMAT_INDEX1:
+    case IMAGE_FORMAT_INDEX2:
+    case IMAGE_FORMAT_INDEX4:
+    case IMAGE_FORMAT_INDEX8: {
+        size_t bits = IMAGE_INDEX_BITS(image->format);
+        size_t stride = (image->width * bits + 7) / 8;
+        uint8_t mask = (1u << bits) - 1;
+
+        for (size_t y = row; y < row + rows; y++) {
+            const uint8_t *data = &image->data[y * stride];
+            for (size_t x = left; x <= right; x++) {
+                size_t shift = 8 - bits - (x * bits) % 8;
+                *buffer++ = image->palette[(data[x * bits / 8] >> shift) & mask];
+            }
+        }
+        break;
+    }
+
+    case IMAGE_FORMAT_RGB565: {
+        const uint16_t *pixels = (const uint16_t *) image->data;
+        for (size_t y = row; y < row + rows; y++, buffer += width) {
+            memcpy(buffer, &pixels[y * image->width + left], width * sizeof(uint16_t));
+        }
+        break;
+    }
+
+    case IMAGE_FORMAT_ALPHA: {
+        const gliph_box_t *box = &decoder->box;
+        size_t ink_left  = max(left, (size_t) box->left);
+        size_t ink_right = min(right + 1, (size_t) box->left + box->width);
+
+        for (size_t y = row; y < row + rows; y++, buffer += width) {
+            if (box->width == 0 || y < box->top || y >= (size_t) box->top + box->height) {
+                for (size_t x = 0; x < width; x++) buffer[x] = back_color;
+                continue;
+            }
+            if (ink_left >= ink_right) {
+                for (size_t x = 0; x < width; x++) buffer[x] = back_color;
+                _display_skip_gliph(decoder, box->width);
+                continue;
+            }
+
+            for (size_t x = left; x < ink_left; x++) buffer[x - left] = back_color;
+            _display_skip_gliph(decoder, ink_left - box->left);
+            _display_decode_gliph(decoder, &buffer[ink_left - left], ink_right - ink_left);
+            _display_skip_gliph(decoder, box->left + box->width - ink_right);
+            for (size_t x = ink_right; x <= right; x++) buffer[x - left] = back_color;
+        }
+        break;
+    }
+
+    default:
+        for (size_t i = 0; i < width * rows; i++) buffer[i] = back_color;
+        break;
+    }
+}
+
+// An image is one window over the part inside the clip. RGB565 rows that are
+// not cut go out by DMA straight from flash, everything else is converted in
+// strips that fit a ping-pong buffer, the next one while the DMA sends the
+// previous one. Nothing is copied to RAM as a whole.
+void _display_draw_image(const draw_image_t *draw) {
+    const image_t *image = draw->image;
+    display_rect_t area;
+
+    if (image->width == 0 || image->height == 0) return;
+    if (!_display_clip_rect(draw->left, draw->left + image->width - 1, draw->top, draw->top + image->height - 1, &display_clip, &area)) return;
+
+    size_t left   = area.left - draw->left;
+    size_t right  = area.right - draw->left;
+    size_t top    = area.top - draw->top;
+    size_t bottom = area.bottom - draw->top;
+    size_t width  = right - left + 1;
+
+    _display_set_window(area.left, area.right, area.top, area.bottom);
+
+    if (image->format == IMAGE_FORMAT_RGB565 && width == image->width) {
+        const uint16_t *pixels = (const uint16_t *) image->data;
+        size_t strip = 0x0000FFFF / width;
+        for (size_t row = top; row <= bottom; row += strip) {
+            size_t rows = min(strip, bottom + 1 - row);
+            display_dma_pixels_to_transfer = rows * width;
+            _display_dma_start(&pixels[row * width], true, row + rows > bottom);
+            _display_wait_dma();
+        }
+        return;
+    }
+
+    gliph_decoder_t decoder = { 0 };
+    if (image->format == IMAGE_FORMAT_ALPHA) {
+        _display_build_alpha_lut(draw->fore_color, draw->back_color);
+        _display_gliph_decoder_init(&decoder, image->data);
+        if (decoder.box.width > 0 && top > decoder.box.top) {
+            _display_skip_gliph(&decoder, min(top - decoder.box.top, (size_t) decoder.box.height) * decoder.box.width);
+        }
+    }
+
+    size_t strip = FONT_MAX_GLIPH_SIZE / width;
+    size_t current = 0;
+    size_t row = top;
+    size_t rows = min(strip, bottom + 1 - top);
+
+    _display_render_image_strip(display_dma_buffer[current], image, &decoder, left, right, row, rows, draw->back_color);
+
+    while (rows > 0) {
+        size_t next = row + rows;
+        size_t next_rows = min(strip, bottom + 1 - next);
+
+        display_dma_pixels_to_transfer = rows * width;
+        _display_dma_start(display_dma_buffer[current], true, next_rows == 0);
+
+        current ^= 1;
+        if (next_rows > 0) _display_render_image_strip(display_dma_buffer[current], image, &decoder, left, right, next, next_rows, draw->back_color);
+
+        _display_wait_dma();
+        row = next;
+        rows = next_rows;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////// END ///
+
+static inline void display_set_backlight(uint32_t value) {
+    if (value) {
+        gpio_set(DISPLAY_BL_PORT, DISPLAY_BL_PIN);
+    } else {
+        gpio_clear(DISPLAY_BL_PORT, DISPLAY_BL_PIN);
+    }
+}
+
+// void display_draw_pixel(uint16_t x, uint16_t y, uint16_t color) {    
+//     if (x >= DISPLAY_WIDTH)  ASSERT("X must be in range 0..DISPLAY_WIDTH-1");    
+//     if (y >= DISPLAY_HEIGHT) ASSERT("Y must be in range 0..DISPLAY_HEIGHT-1");
+
+//     display_set_window(x, y, x, y);
+//     display_color_fill(color, 1);
+// }
+
+static inline void display_init_gpio(void) {
+
+    // Data / Command
+    gpio_mode_setup(DISPLAY_DC_PORT, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DISPLAY_DC_PIN);
+    gpio_set_output_options(DISPLAY_DC_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_DC_PIN);
+
+    // Backlight
+    gpio_mode_setup(DISPLAY_BL_PORT, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DISPLAY_BL_PIN);
+    gpio_set_output_options(DISPLAY_BL_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_BL_PIN);
+
+    // Tearing effect
+    gpio_mode_setup(DISPLAY_TE_PORT, GPIO_MODE_INPUT, GPIO_PUPD_PULLDOWN, DISPLAY_TE_PIN);
+
+    // Reset
+    gpio_set(DISPLAY_RST_PORT, DISPLAY_RST_PIN);
+    gpio_mode_setup(DISPLAY_RST_PORT, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DISPLAY_RST_PIN);
+    gpio_set_output_options(DISPLAY_RST_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_RST_PIN);
+
+    // SS
+    gpio_set(DISPLAY_SPI_PORT, DISPLAY_CS_PIN);
+    gpio_mode_setup(DISPLAY_SPI_PORT, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DISPLAY_CS_PIN);
+    gpio_set_output_options(DISPLAY_SPI_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_CS_PIN);
+
+    // SPI
+    gpio_mode_setup(DISPLAY_SPI_PORT, GPIO_MODE_AF, GPIO_PUPD_NONE, DISPLAY_SCK_PIN | DISPLAY_MOSI_PIN);
+    gpio_set_af(DISPLAY_SPI_PORT, DISPLAY_SPI_GPIO_AF, DISPLAY_SCK_PIN | DISPLAY_MOSI_PIN);
+    gpio_set_output_options(DISPLAY_SPI_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_100MHZ, DISPLAY_SCK_PIN | DISPLAY_MOSI_PIN);
+}
+
+static inline void display_init_spi(void) {
+    spi_init_master(DISPLAY_SPI, SPI_CR1_BAUDRATE_FPCLK_DIV_2, SPI_CR1_CPOL_CLK_TO_0_WHEN_IDLE, SPI_CR1_CPHA_CLK_TRANSITION_1, SPI_CR1_DFF_8BIT, SPI_CR1_MSBFIRST);
+}
+
+static inline void display_init_dma(void) {
+    dma_stream_reset(DISPLAY_DMA, DISPLAY_DMA_STREAM);
+    dma_set_transfer_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxCR_DIR_MEM_TO_PERIPHERAL);
+    dma_set_peripheral_size(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxCR_PSIZE_16BIT); 
+    dma_set_memory_size(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxCR_MSIZE_16BIT);
+    dma_disable_peripheral_increment_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
+    dma_enable_transfer_complete_interrupt(DISPLAY_DMA, DISPLAY_DMA_STREAM);    
+    dma_enable_fifo_mode(DISPLAY_DMA, DISPLAY_DMA_STREAM);
+    dma_set_fifo_threshold(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxFCR_FTH_4_4_FULL);    
+    dma_set_priority(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_SxCR_PL_VERY_HIGH);
+
+    // dma_set_peripheral_address(DISPLAY_DMA, DISPLAY_DMA_STREAM, SPI_DR(DISPLAY_SPI));  
+    dma_set_peripheral_address(DISPLAY_DMA, DISPLAY_DMA_STREAM, 0x4000380C);  
+    nvic_enable_irq(NVIC_DMA1_STREAM4_IRQ);
+}
+
+// TE rising edges interrupt once _display_vsync_update() turns TE on, the
+// cycle counter times them
+static inline void display_init_te(void) {
+    exti_select_source(DISPLAY_TE_EXTI, DISPLAY_TE_PORT);
+    exti_set_trigger(DISPLAY_TE_EXTI, EXTI_TRIGGER_RISING);
+    nvic_enable_irq(DISPLAY_TE_IRQ);
+}
+
+static inline void display_set_color_mode(uint8_t mode) {
+    spi_set_dff_8bit(DISPLAY_SPI);
+    _display_set_command();
+    spi_enable(DISPLAY_SPI);
+    display_set_cs_low();
+    spi_write(DISPLAY_SPI, ST7789_COLMOD);
+    _display_wait_spi();
+    gpio_set(DISPLAY_DC_PORT, DISPLAY_DC_PIN);
+    spi_write(DISPLAY_SPI, mode);
+    spi_clean_disable(DISPLAY_SPI);
+    _display_set_cs_high();
+    vTaskDelay(10);
+}
+
+static inline void display_set_memory_mode(uint8_t mode) {    
+    spi_set_dff_8bit(DISPLAY_SPI);
+    _display_set_command();
+    spi_enable(DISPLAY_SPI);
+    display_set_cs_low();
+    spi_write(DISPLAY_SPI, ST7789_MADCTL);
+    _display_wait_spi();
+    gpio_set(DISPLAY_DC_PORT, DISPLAY_DC_PIN);
+    spi_write(DISPLAY_SPI, mode);
+    spi_clean_disable(DISPLAY_SPI);
+    _display_set_cs_high();
+    vTaskDelay(10);
+}
+
+static inline void display_inverted(void) {
+    _display_set_command();
+    spi_set_dff_8bit(DISPLAY_SPI);
+    spi_enable(DISPLAY_SPI);
+    display_set_cs_low();
+    spi_write(DISPLAY_SPI, ST7789_INVON);
+    spi_clean_disable(DISPLAY_SPI);
+    _display_set_cs_high();
+    vTaskDelay(10);
+}
+
+static inline void display_normal(void) {
+    _display_set_command();
+    spi_set_dff_8bit(DISPLAY_SPI);
+    spi_enable(DISPLAY_SPI);
+    display_set_cs_low();
+    spi_write(DISPLAY_SPI, ST7789_NORON);
+    spi_clean_disable(DISPLAY_SPI);
+    _display_set_cs_high();
+    vTaskDelay(10);
+}
+
+static inline void display_on(void) {
+    _display_set_command();
+    spi_set_dff_8bit(DISPLAY_SPI);
+    spi_enable(DISPLAY_SPI);
+    display_set_cs_low();
+    spi_write(DISPLAY_SPI, ST7789_DISPON);
+    spi_clean_disable(DISPLAY_SPI);
+    _display_set_cs_high();
+    vTaskDelay(10);
+}
+
+void _display_init(void) {
+    display_init_spi();
+    display_init_gpio();
+    display_init_dma();
+
+    _display_hard_reset();
+    _display_soft_reset();
+    dwt_enable_cycle_counter();
+    _display_sleep_exit();
+    _display_vsync_phase();
+    display_vsync_period = DISPLAY_FRAME_CYCLES;
+    display_vsync_te = false;
+    vTaskDelay(500);
+
+    nvic_enable_irq(NVIC_DMA1_STREAM4_IRQ);
+    nvic_enable_irq(NVIC_SPI2_IRQ);
+
+    display_set_color_mode(ST7789_16bit | ST7789_RGB_65k);
     display_inverted();
     display_normal();
     display_on();
     display_set_memory_mode(ST7789_MADCTL_RGB);
+    display_init_te();
+
+    // From here on the bus stays enabled, see _display_spi_frame_size()
+    spi_set_dff_8bit(DISPLAY_SPI);
+    spi_enable(DISPLAY_SPI);
+    display_spi_16bit = false;
 }
 
 
@@ -418,89 +1403,1056 @@ void dma2_stream7_isr(void) {
         dma_clear_interrupt_flags(DISPLAY_DMA, DISPLAY_DMA_STREAM, DMA_TCIF);
 
         if (display_dma_pixels_to_transfer > 0) {
-            if (display_dma_pixels_to_transfer > 0x0000FFFF) {
-                dma_set_number_of_data(DISPLAY_DMA, DISPLAY_DMA_STREAM, 0x0000FFFF);
-                display_dma_pixels_to_transfer -= 0x0000FFFF;
-            } else {
-                dma_set_number_of_data(DISPLAY_DMA, DISPLAY_DMA_STREAM, display_dma_pixels_to_transfer);
-                display_dma_pixels_to_transfer = 0;
-            }            
+            _display_dma_next();
         } else {
             spi_disable_tx_dma(DISPLAY_SPI);
             dma_disable_stream(DISPLAY_DMA, DISPLAY_DMA_STREAM);
             dma_disable_transfer_complete_interrupt(DISPLAY_DMA, DISPLAY_DMA_STREAM);
-            spi_clean_disable(DISPLAY_SPI);
-            _display_set_cs_high();
+            if (display_dma_release) {
+                _display_wait_spi();
+                _display_set_cs_high();
+                if (display_vsync_pending) _display_vsync_done();
+            }
             vTaskNotifyGiveFromISR(hDisplayTask, pdFALSE);
         }
     }
 }
 
-////////////////////////////////////////////////////////////////////////////////////// TASK ///
-
-void _display_task(void *pvParameters) {
-    (void) pvParameters;
-    display_command_t command;
+#if DISPLAY_SPI == SPI1
+void spi1_isr(void) {
+#elif DISPLAY_SPI == SPI2
+void spi2_isr(void) {
+#endif
+    if (!(SPI_SR(DISPLAY_SPI) & SPI_SR_RXNE)) return;
+    (void) SPI_DR(DISPLAY_SPI);
 
-    display_set_backlight(100);
-    display_init();
-    
-    for (;;) {
-        if (xQueueReceive(hDisplayQueue, &command, portMAX_DELAY) == pdPASS) {
-            switch (command.id) {
-            case DISPLAY_COMMAND_FILL_SCREEN:
-                _display_fill_screen_dma(
-                    command.fill_screen.color
-                );
-                break;
-            
-            case DISPLAY_COMMAND_FILL_RECT:
-                _display_color_fill_dma(
-                    command.fill_rect.left,
-                    command.fill_rect.right,
-                    command.fill_rect.top,
-                    command.fill_rect.bottom,
-                    command.fill_rect.color
-                );
-                break;
+    if (display_spi_sent < display_spi_count) {
+        _display_spi_next();
+        return;
+    }
 
-            case DISPLAY_COMMAND_DRAW_RECT:
-                _display_draw_rect(
-                    command.draw_rect.left,
-                    command.draw_rect.right,
-                    command.draw_rect.top,
-                    command.draw_rect.bottom,
-                    command.draw_rect.color,
-                    command.draw_rect.border_color
-                );
-                break;
+    spi_disable_rx_buffer_not_empty_interrupt(DISPLAY_SPI);
+    _display_set_data();
+    vTaskNotifyGiveFromISR(hDisplayTask, pdFALSE);
+}
 
-            case DISPLAY_COMMAND_DRAW_TEXT:
-                _display_draw_text(
-                    command.draw_text.font,
-                    command.draw_text.left,
-                    command.draw_text.top,
-                    command.draw_text.fore_color,
-                    command.draw_text.back_color,
-                    command.draw_text.text,
-                    wcsnlen(command.draw_text.text, sizeof(command.draw_text.text))
-                );
-                break;
+// TE rises once per frame. Edges a frame apart measure the period, the first
+// measurement replaces the nominal one and later ones refine it. The other
+// edges (the first one, one after missed edges) only set the phase.
+void DISPLAY_TE_ISR(void) {
+    static uint32_t last;
+    static bool measured;
+
+    if (!exti_get_flag_status(DISPLAY_TE_EXTI)) return;
+    exti_reset_request(DISPLAY_TE_EXTI);
+    if (display_vsync != DISPLAY_VSYNC_TE) return;
+
+    uint32_t now = _display_cycles();
+    uint32_t period = now - last;
+    if (period > DISPLAY_FRAME_CYCLES * 3 / 4 && period < DISPLAY_FRAME_CYCLES * 5 / 4) {
+        int32_t error = period - display_vsync_period;
+        display_vsync_period += measured ? error / 8 : error;
+        measured = true;
+    }
+    last = now;
+    display_vsync_edge = now;
+}
+
+////////////////////////////////////////////////////////////////////////////////////// RING ///
+
+// Commands go through a byte ring instead of a queue of fixed-size items, so
+// producers only copy what a command needs and strings of any length fit in
+// one command. Producers reserve a record, write it in place and commit it;
+// the lock keeps them in order. The display task reads records where they
+// are and releases them once drawn. A record never wraps around the end of
+// the ring, the rest of the ring is skipped with a PAD record instead.
+
+static uint8_t display_ring[DISPLAY_RING_SIZE] __attribute__((aligned(DISPLAY_RECORD_ALIGNMENT)));
+_Static_assert(DISPLAY_RING_SIZE % DISPLAY_RECORD_ALIGNMENT == 0, "DISPLAY_RING_SIZE must be a multiple of the record alignment");
+volatile size_t display_ring_head;          // Free-running, written by producers
+volatile size_t display_ring_tail;          // Free-running, written by the display task
+static volatile size_t display_ring_claimed;    // Records before it are read by the display task
+static StaticSemaphore_t display_ring_semaphores[4];
+
+// Every committed record takes the next sequence number, the display task
+// counts the records it reads. Both are free-running and compared as a
+// difference, so they may wrap.
+static display_fence_t display_fence_submitted;
+static volatile display_fence_t display_fence_claimed;
+static volatile display_fence_t display_fence_completed;
+
+static display_policy_t display_policy = DISPLAY_POLICY;
+static TickType_t display_policy_timeout = DISPLAY_POLICY_TIMEOUT;
+
+// A full ring under DISPLAY_POLICY_OVERWRITE, the command is written here and
+// copied over its pending predecessor on commit
+static display_record_t display_ring_staging;
+
+static void _display_ring_stalled(TickType_t ticks) {
+    display_stats.stalls++;
+    display_stats.stall_ticks += ticks;
+    display_stats.stall_ticks_max = max(display_stats.stall_ticks_max, (uint32_t) ticks);
+}
+
+// Returns NULL if the policy gives up on a full ring
+display_command_t *_display_ring_reserve(uint8_t id, size_t size) {
+    display_command_t *command;
+    size = DISPLAY_RECORD_ALIGN(size);
+    configASSERT(size <= DISPLAY_RING_SIZE / 2);
+
+    xSemaphoreTake(hDisplayRingLock, portMAX_DELAY);
+
+    TickType_t start = xTaskGetTickCount();
+    bool stalled = false;
+
+    for (;;) {
+        size_t offset = display_ring_head % DISPLAY_RING_SIZE;
+        size_t free = DISPLAY_RING_SIZE - (display_ring_head - display_ring_tail);
+
+        if (offset + size <= DISPLAY_RING_SIZE) {
+            if (size <= free) break;
+        } else if (DISPLAY_RING_SIZE - offset <= free) {
+            display_command_t *pad = (display_command_t *) &display_ring[offset];
+            pad->id   = DISPLAY_COMMAND_PAD;
+            pad->size = DISPLAY_RING_SIZE - offset;
+            display_ring_head += pad->size;
+            xSemaphoreGive(hDisplayRingData);
+            continue;
+        }
+
+        if (display_policy == DISPLAY_POLICY_BLOCK) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (display_policy_timeout == portMAX_DELAY || elapsed < display_policy_timeout) {
+                stalled = true;
+                xSemaphoreTake(hDisplayRingSpace, display_policy_timeout == portMAX_DELAY ? portMAX_DELAY : display_policy_timeout - elapsed);
+                continue;
+            }
+        } else if (display_policy == DISPLAY_POLICY_OVERWRITE && size <= sizeof(display_ring_staging)) {
+            command = &display_ring_staging.command;
+            command->id   = id;
+            command->size = size;
+            return command;
+        }
+
+        if (stalled) _display_ring_stalled(xTaskGetTickCount() - start);
+        display_stats.commands_rejected++;
+        xSemaphoreGive(hDisplayRingLock);
+        return NULL;
+    }
+
+    if (stalled) _display_ring_stalled(xTaskGetTickCount() - start);
+
+    command = (display_command_t *) &display_ring[display_ring_head % DISPLAY_RING_SIZE];
+    command->id   = id;
+    command->size = size;
+    return command;
+}
+
+// Copy the staged command over the newest pending record of the same kind,
+// size and area, the display task has not read it yet
+static display_fence_t _display_ring_replace(const display_command_t *command) {
+    display_fence_t fence = DISPLAY_FENCE_NONE;
+    display_rect_t area, rect;
+
+    if (!_display_command_rect(command, &area)) return DISPLAY_FENCE_NONE;
+
+    taskENTER_CRITICAL();
+    display_command_t *target = NULL;
+    display_fence_t sequence = display_fence_claimed;
+    for (size_t position = display_ring_claimed; position != display_ring_head; ) {
+        display_command_t *record = (display_command_t *) &display_ring[position % DISPLAY_RING_SIZE];
+        position += record->size;
+        if (record->id == DISPLAY_COMMAND_PAD) continue;
+
+        sequence++;
+        if (record->id == command->id && record->size == command->size && _display_command_rect(record, &rect)
+            && rect.left == area.left && rect.right == area.right && rect.top == area.top && rect.bottom == area.bottom) {
+            target = record;
+            fence  = sequence;
+        }
+    }
+    if (target != NULL) memcpy(target, command, command->size);
+    taskEXIT_CRITICAL();
+
+    return fence;
+}
+
+display_fence_t _display_ring_commit(display_command_t *command) {
+    display_fence_t fence;
+
+    if (command == &display_ring_staging.command) {
+        fence = _display_ring_replace(command);
+        if (fence == DISPLAY_FENCE_NONE) {
+            display_stats.commands_rejected++;
+        } else {
+            display_stats.commands_replaced++;
+        }
+    } else {
+        display_ring_head += command->size;
+        if (++display_fence_submitted == DISPLAY_FENCE_NONE) ++display_fence_submitted;
+        fence = display_fence_submitted;
+        xSemaphoreGive(hDisplayRingData);
+
+        display_stats.ring_bytes_max  = max(display_stats.ring_bytes_max, (uint32_t) (display_ring_head - display_ring_tail));
+        display_stats.queue_depth_max = max(display_stats.queue_depth_max, (uint32_t) (display_fence_submitted - display_fence_completed));
+    }
+
+    xSemaphoreGive(hDisplayRingLock);
+    return fence;
+}
+
+// Next committed record at position, which is advanced past it; NULL when
+// the display task has caught up with the producers or the record is a
+// display list of more than room commands. Producers may replace records
+// until they are read here.
+display_command_t *_display_ring_peek(size_t *position, size_t room) {
+    display_command_t *command = NULL;
+
+    taskENTER_CRITICAL();
+    while (*position != display_ring_head) {
+        display_command_t *record = (display_command_t *) &display_ring[*position % DISPLAY_RING_SIZE];
+        if (record->id == DISPLAY_COMMAND_LIST && record->list.count > room) break;
+        *position += record->size;
+        if (record->id != DISPLAY_COMMAND_PAD) {
+            command = record;
+            display_fence_claimed++;
+            break;
+        }
+    }
+    display_ring_claimed = *position;
+    taskEXIT_CRITICAL();
+
+    return command;
+}
+
+// Hand everything before position back to the producers, the commands read so
+// far are done
+void _display_ring_release(size_t position) {
+    display_ring_tail = position;
+    xSemaphoreGive(hDisplayRingSpace);
+
+    if (display_fence_completed != display_fence_claimed) {
+        display_fence_completed = display_fence_claimed;
+        xSemaphoreGive(hDisplayFenceDone);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////// POWER ///
+
+// When nothing outside the status strip has been drawn for the timeout, the
+// UI is static: the panel is switched to partial mode over the strip and to
+// idle mode, and the task draws strip updates once per period, so the
+// compositor only sends the last state of everything that arrived in between.
+// Drawing outside the strip or display_wake() (on input) restores normal mode.
+
+static display_rect_t display_power_strip = { 0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1 };
+static TickType_t display_power_timeout = DISPLAY_POWER_TIMEOUT;
+static TickType_t display_power_activity;       // Last drawing outside the strip
+static TickType_t display_power_refresh;        // Last batch drawn in low power
+static volatile bool display_power_wake;
+static StaticSemaphore_t display_power_semaphore;
+bool display_low_power;
+
+void _display_power_enter(void) {
+    if (display_low_power) return;
+
+    uint16_t rows[2] = { display_power_strip.top + DISPLAY_OFFSET_Y, display_power_strip.bottom + DISPLAY_OFFSET_Y };
+    _display_write_words(ST7789_PTLAR, rows, 2);
+    _display_write_words(ST7789_PTLON, NULL, 0);
+    _display_write_words(ST7789_IDMON, NULL, 0);
+
+    display_low_power = true;
+    display_power_refresh = xTaskGetTickCount();
+    display_stats.low_power_entries++;
+}
+
+// Back to normal mode and restart the timeout
+void _display_power_activity(void) {
+    display_power_activity = xTaskGetTickCount();
+    if (!display_low_power) return;
+
+    _display_write_words(ST7789_IDMOFF, NULL, 0);
+    _display_write_words(ST7789_NORON, NULL, 0);
+    display_low_power = false;
+}
+
+// How long the task may wait for commands before the UI counts as static
+TickType_t _display_power_timeout(TickType_t now) {
+    if (display_low_power || display_power_timeout == 0) return portMAX_DELAY;
+
+    TickType_t elapsed = now - display_power_activity;
+    return elapsed < display_power_timeout ? display_power_timeout - elapsed : 0;
+}
+
+// In low power, how long new commands wait for the next refresh. A ring that
+// is half full is drawn at once, so producers do not stall for the period.
+TickType_t _display_power_hold(TickType_t now) {
+    if (!display_low_power) return 0;
+    if (display_ring_head - display_ring_tail >= DISPLAY_RING_SIZE / 2) return 0;
+
+    TickType_t elapsed = now - display_power_refresh;
+    return elapsed < DISPLAY_POWER_PERIOD ? DISPLAY_POWER_PERIOD - elapsed : 0;
+}
+
+// Called by the task before each round of drawing
+void _display_power_update(bool outside) {
+    if (display_power_wake) {
+        display_power_wake = false;
+        outside = true;
+    }
+    if (outside) _display_power_activity();
+    if (display_low_power) display_power_refresh = xTaskGetTickCount();
+}
+
+//////////////////////////////////////////////////////////////////////////////// COMPOSITOR ///
+
+// The task hands the compositor everything that is committed when it wakes up,
+// the commands of a display list count one by one.
+// Inside such a batch a command whose area a later opaque command repaints
+// completely is dropped, and a fill that extends the previous fill of the same
+// color to a larger rectangle is merged into it. Across batches the last drawn
+// commands are retained: repeating one of them over an area that nothing has
+// touched since cannot change the panel and is dropped as well.
+
+// Retained commands are copies of their records, longer texts are not kept.
+// The same command drawn with another clip paints other pixels.
+static display_record_t display_retained[DISPLAY_COMPOSITOR_RETAINED];
+static display_rect_t display_retained_clip[DISPLAY_COMPOSITOR_RETAINED];
+static size_t display_retained_count;
+
+static inline uint32_t _display_rect_area(const display_rect_t *rect) {
+    return (uint32_t) (rect->right - rect->left + 1) * (rect->bottom - rect->top + 1);
+}
+
+static inline bool _display_rect_contains(const display_rect_t *outer, const display_rect_t *inner) {
+    return outer->left <= inner->left && inner->right <= outer->right && outer->top <= inner->top && inner->bottom <= outer->bottom;
+}
+
+static inline bool _display_rect_equal(const display_rect_t *a, const display_rect_t *b) {
+    return a->left == b->left && a->right == b->right && a->top == b->top && a->bottom == b->bottom;
+}
+
+static inline bool _display_rect_intersects(const display_rect_t *a, const display_rect_t *b) {
+    return a->left <= b->right && b->left <= a->right && a->top <= b->bottom && b->top <= a->bottom;
+}
+
+// Area the command paints on the panel, false if it paints nothing there
+bool _display_command_rect(const display_command_t *command, display_rect_t *rect) {
+    static const display_rect_t panel = { 0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1 };
+
+    switch (command->id) {
+    case DISPLAY_COMMAND_FILL_SCREEN:
+        *rect = panel;
+        return true;
+
+    case DISPLAY_COMMAND_FILL_RECT: {
+        const fill_rect_t *fill = &command->fill_rect;
+        return _display_clip_rect(fill->left, fill->right, fill->top, fill->bottom, &panel, rect);
+    }
+
+    case DISPLAY_COMMAND_DRAW_RECT: {
+        const draw_rect_t *draw = &command->draw_rect;
+        return _display_clip_rect(draw->left, draw->right, draw->top, draw->bottom, &panel, rect);
+    }
+
+    case DISPLAY_COMMAND_ROUND_RECT: {
+        const round_rect_t *round = &command->round_rect;
+        return _display_clip_rect(round->left, round->right, round->top, round->bottom, &panel, rect);
+    }
+
+    // Sides left of the panel are cut off before they wrap
+    case DISPLAY_COMMAND_DRAW_ARC: {
+        const draw_arc_t *arc = &command->draw_arc;
+        return _display_clip_rect(max(arc->x - arc->radius, 0), arc->x + arc->radius, max(arc->y - arc->radius, 0), arc->y + arc->radius, &panel, rect);
+    }
+
+    case DISPLAY_COMMAND_DRAW_TEXT: {
+        const draw_text_t *text = &command->draw_text;
+        if (text->length == 0) return false;
+        return _display_clip_rect(text->left, text->left + text->length * text->font->width - 1, text->top, text->top + text->font->height - 1, &panel, rect);
+    }
+
+    case DISPLAY_COMMAND_DRAW_IMAGE: {
+        const draw_image_t *draw = &command->draw_image;
+        if (draw->image->width == 0 || draw->image->height == 0) return false;
+        return _display_clip_rect(draw->left, draw->left + draw->image->width - 1, draw->top, draw->top + draw->image->height - 1, &panel, rect);
+    }
+
+    default:
+        return false;
+    }
+}
+
+// True if the command sets every pixel of its rect
+static inline bool _display_command_opaque(const display_command_t *command) {
+    return command->id == DISPLAY_COMMAND_FILL_SCREEN
+        || command->id == DISPLAY_COMMAND_FILL_RECT
+        || command->id == DISPLAY_COMMAND_DRAW_RECT
+        || command->id == DISPLAY_COMMAND_DRAW_TEXT
+        || command->id == DISPLAY_COMMAND_DRAW_IMAGE;
+}
+
+// True if the band renderer can cut the command into pieces
+static inline bool _display_command_banded(const display_command_t *command) {
+    return command->id == DISPLAY_COMMAND_FILL_SCREEN
+        || command->id == DISPLAY_COMMAND_FILL_RECT
+        || command->id == DISPLAY_COMMAND_DRAW_RECT
+        || command->id == DISPLAY_COMMAND_DRAW_TEXT;
+}
 
-            default:
+// Commands that change how GRAM is shown rather than its content. They paint
+// nothing and run in order with the drawing around them.
+static inline bool _display_command_is_state(const display_command_t *command) {
+    return command->id == DISPLAY_COMMAND_SCROLL_AREA || command->id == DISPLAY_COMMAND_SCROLL || command->id == DISPLAY_COMMAND_CLIP;
+}
+
+static inline bool _display_command_is_fill(const display_command_t *command) {
+    return command->id == DISPLAY_COMMAND_FILL_SCREEN || command->id == DISPLAY_COMMAND_FILL_RECT;
+}
+
+static inline uint16_t _display_fill_color(const display_command_t *command) {
+    return command->id == DISPLAY_COMMAND_FILL_SCREEN ? command->fill_screen.color : command->fill_rect.color;
+}
+
+// Records may carry stale padding, so compare fields, not bytes
+static bool _display_command_equal(const display_command_t *a, const display_command_t *b) {
+    if (a->id != b->id) return false;
+
+    switch (a->id) {
+    case DISPLAY_COMMAND_FILL_SCREEN:
+        return a->fill_screen.color == b->fill_screen.color;
+
+    case DISPLAY_COMMAND_FILL_RECT:
+        return a->fill_rect.color  == b->fill_rect.color
+            && a->fill_rect.left   == b->fill_rect.left
+            && a->fill_rect.right  == b->fill_rect.right
+            && a->fill_rect.top    == b->fill_rect.top
+            && a->fill_rect.bottom == b->fill_rect.bottom;
+
+    case DISPLAY_COMMAND_DRAW_RECT:
+        return a->draw_rect.color        == b->draw_rect.color
+            && a->draw_rect.border_color == b->draw_rect.border_color
+            && a->draw_rect.left         == b->draw_rect.left
+            && a->draw_rect.right        == b->draw_rect.right
+            && a->draw_rect.top          == b->draw_rect.top
+            && a->draw_rect.bottom       == b->draw_rect.bottom
+            && a->draw_rect.border       == b->draw_rect.border;
+
+    case DISPLAY_COMMAND_ROUND_RECT:
+        return a->round_rect.color      == b->round_rect.color
+            && a->round_rect.back_color == b->round_rect.back_color
+            && a->round_rect.left       == b->round_rect.left
+            && a->round_rect.right      == b->round_rect.right
+            && a->round_rect.top        == b->round_rect.top
+            && a->round_rect.bottom     == b->round_rect.bottom
+            && a->round_rect.radius     == b->round_rect.radius;
+
+    case DISPLAY_COMMAND_DRAW_ARC:
+        return a->draw_arc.color      == b->draw_arc.color
+            && a->draw_arc.back_color == b->draw_arc.back_color
+            && a->draw_arc.x          == b->draw_arc.x
+            && a->draw_arc.y          == b->draw_arc.y
+            && a->draw_arc.radius     == b->draw_arc.radius
+            && a->draw_arc.thickness  == b->draw_arc.thickness
+            && a->draw_arc.start      == b->draw_arc.start
+            && a->draw_arc.end        == b->draw_arc.end;
+
+    case DISPLAY_COMMAND_DRAW_TEXT:
+        return a->draw_text.font       == b->draw_text.font
+            && a->draw_text.fore_color == b->draw_text.fore_color
+            && a->draw_text.back_color == b->draw_text.back_color
+            && a->draw_text.left       == b->draw_text.left
+            && a->draw_text.top        == b->draw_text.top
+            && a->draw_text.length     == b->draw_text.length
+            && wmemcmp(_display_command_text(a), _display_command_text(b), a->draw_text.length) == 0;
+
+    case DISPLAY_COMMAND_DRAW_IMAGE:
+        return a->draw_image.image      == b->draw_image.image
+            && a->draw_image.fore_color == b->draw_image.fore_color
+            && a->draw_image.back_color == b->draw_image.back_color
+            && a->draw_image.left       == b->draw_image.left
+            && a->draw_image.top        == b->draw_image.top;
+
+    default:
+        return false;
+    }
+}
+
+// Merge the fill next into fill into when both have the same color and their
+// union is a rectangle. The record of into is rewritten in place, so a
+// FILL_SCREEN never grows into a (larger) FILL_RECT.
+static bool _display_fill_merge(display_command_t *into, const display_command_t *next) {
+    display_rect_t a, b;
+
+    if (!_display_command_is_fill(into) || !_display_command_is_fill(next)) return false;
+    if (_display_fill_color(into) != _display_fill_color(next)) return false;
+    if (!_display_command_rect(into, &a) || !_display_command_rect(next, &b)) return false;
+
+    if (_display_rect_contains(&a, &b)) return true;
+
+    bool columns = a.left == b.left && a.right == b.right && b.top <= a.bottom + 1 && a.top <= b.bottom + 1;
+    bool rows    = a.top == b.top && a.bottom == b.bottom && b.left <= a.right + 1 && a.left <= b.right + 1;
+    if (!columns && !rows && !_display_rect_contains(&b, &a)) return false;
+
+    if (next->id == DISPLAY_COMMAND_FILL_SCREEN) {
+        into->id                = DISPLAY_COMMAND_FILL_SCREEN;
+        into->fill_screen.color = next->fill_screen.color;
+    } else if (into->id == DISPLAY_COMMAND_FILL_SCREEN) {
+        return false;
+    } else {
+        into->id               = DISPLAY_COMMAND_FILL_RECT;
+        into->fill_rect.color  = next->fill_rect.color;
+        into->fill_rect.left   = min(a.left, b.left);
+        into->fill_rect.right  = max(a.right, b.right);
+        into->fill_rect.top    = min(a.top, b.top);
+        into->fill_rect.bottom = max(a.bottom, b.bottom);
+    }
+    return true;
+}
+
+static bool _display_retained_find(const display_command_t *command, const display_rect_t *clip) {
+    for (size_t i = 0; i < display_retained_count; i++) {
+        if (_display_command_equal(&display_retained[i].command, command) && _display_rect_equal(&display_retained_clip[i], clip)) return true;
+    }
+    return false;
+}
+
+// Forget every retained command the new one paints over, then remember it
+static void _display_retain(const display_command_t *command, const display_rect_t *rect, const display_rect_t *clip) {
+    size_t count = 0;
+    for (size_t i = 0; i < display_retained_count; i++) {
+        display_rect_t retained;
+        if (_display_command_rect(&display_retained[i].command, &retained) && _display_rect_intersects(&retained, rect)) continue;
+        display_retained_clip[count] = display_retained_clip[i];
+        display_retained[count++] = display_retained[i];
+    }
+
+    // Oldest entry goes first when the table is full
+    if (command->size <= sizeof(display_retained[0])) {
+        if (count == DISPLAY_COMPOSITOR_RETAINED) {
+            memmove(&display_retained[0], &display_retained[1], (count - 1) * sizeof(display_retained[0]));
+            memmove(&display_retained_clip[0], &display_retained_clip[1], (count - 1) * sizeof(display_retained_clip[0]));
+            count--;
+        }
+        display_retained_clip[count] = *clip;
+        memcpy(display_retained[count++].bytes, command, command->size);
+    }
+    display_retained_count = count;
+}
+
+void _display_compositor_reset(void) {
+    display_retained_count = 0;
+}
+
+// Draw the commands waiting in the ring, false if there were none
+bool _display_compose(void) {
+    // Static, the display task only has a stack of 256 words
+    static display_command_t *batch[DISPLAY_COMPOSITOR_BATCH];
+    static display_rect_t rects[DISPLAY_COMPOSITOR_BATCH];
+    static bool visible[DISPLAY_COMPOSITOR_BATCH];
+    size_t position = display_ring_tail;
+    size_t count = 0;
+
+    // A display list joins the batch with all of its commands or waits for
+    // the next one
+    while (count < DISPLAY_COMPOSITOR_BATCH) {
+        display_command_t *command = _display_ring_peek(&position, DISPLAY_COMPOSITOR_BATCH - count);
+        if (command == NULL) break;
+
+        if (command->id == DISPLAY_COMMAND_LIST) {
+            display_command_t *record = _display_list_records(command);
+            for (size_t i = 0; i < command->list.count; i++) {
+                batch[count++] = record;
+                record = (display_command_t *) ((uint8_t *) record + record->size);
+            }
+            display_stats.lists++;
+        } else {
+            batch[count++] = command;
+        }
+    }
+
+    // Padding is released even if nothing follows it yet
+    if (count == 0) {
+        _display_ring_release(position);
+        return false;
+    }
+
+    // Areas are trimmed to the clip each command is drawn with
+    display_rect_t clip = display_clip;
+    bool outside = false;
+    for (size_t i = 0; i < count; i++) {
+        if (batch[i]->id == DISPLAY_COMMAND_CLIP) clip = (display_rect_t) { batch[i]->clip.left, batch[i]->clip.right, batch[i]->clip.top, batch[i]->clip.bottom };
+        visible[i] = _display_command_rect(batch[i], &rects[i]) && _display_clip_rect(rects[i].left, rects[i].right, rects[i].top, rects[i].bottom, &clip, &rects[i]);
+        display_stats.commands++;
+        if (visible[i]) display_stats.pixels_submitted += _display_rect_area(&rects[i]);
+        if (visible[i] && !_display_rect_contains(&display_power_strip, &rects[i])) outside = true;
+    }
+    _display_power_update(outside);
+    _display_vsync_update();
+
+    if (display_compositor_bypass) {
+        for (size_t i = 0; i < count; i++) {
+            _display_execute(batch[i]);
+            if (visible[i]) display_stats.pixels_drawn += _display_rect_area(&rects[i]);
+        }
+        _display_ring_release(position);
+        return true;
+    }
+
+    // Drop commands a later opaque command hides completely
+    for (size_t i = 0; i < count; i++) {
+        if (!visible[i]) continue;
+        for (size_t j = i + 1; j < count; j++) {
+            if (visible[j] && _display_command_opaque(batch[j]) && _display_rect_contains(&rects[j], &rects[i])) {
+                visible[i] = false;
                 break;
             }
         }
+        if (!visible[i]) display_stats.commands_dropped++;
+    }
+
+    // Join fills with the previous fill that is still drawn, never across a
+    // state command. Under one clip the area of the union is the union of the
+    // areas.
+    size_t previous = count;
+    for (size_t i = 0; i < count; i++) {
+        if (_display_command_is_state(batch[i])) previous = count;
+        if (!visible[i]) continue;
+        if (previous < count && _display_fill_merge(batch[previous], batch[i])) {
+            rects[previous] = (display_rect_t) {
+                min(rects[previous].left, rects[i].left), max(rects[previous].right, rects[i].right),
+                min(rects[previous].top, rects[i].top), max(rects[previous].bottom, rects[i].bottom)
+            };
+            visible[i] = false;
+            display_stats.commands_merged++;
+            continue;
+        }
+        previous = i;
+    }
+
+    // Band mode draws the survivors together after the loop
+    bool bands = display_render_mode == DISPLAY_RENDER_BANDS;
+    size_t drawn = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        // The pixels of the batch so far go out first, e.g. the newest chart
+        // row before the scroll that reveals it
+        if (_display_command_is_state(batch[i])) {
+            if (bands) _display_render_bands(batch, drawn);
+            drawn = 0;
+            _display_execute(batch[i]);
+            continue;
+        }
+
+        if (!visible[i]) continue;
+
+        if (_display_retained_find(batch[i], &display_clip)) {
+            display_stats.commands_dropped++;
+            continue;
+        }
+
+        // Shapes and images go out on their own, after the bands before them
+        if (bands && _display_command_banded(batch[i])) {
+            batch[drawn++] = batch[i];
+        } else {
+            if (bands) _display_render_bands(batch, drawn);
+            drawn = 0;
+            _display_execute(batch[i]);
+        }
+        _display_retain(batch[i], &rects[i], &display_clip);
+        display_stats.pixels_drawn += _display_rect_area(&rects[i]);
+    }
+
+    if (bands) _display_render_bands(batch, drawn);
+
+    _display_ring_release(position);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////// BANDS ///
+
+// Optional render mode. The commands the compositor keeps from a batch are
+// rasterized together instead of getting a window each. They are cut into
+// opaque pieces (a DRAW_RECT into the fills it is made of), rows where the
+// same columns are painted are merged into one segment and each run of painted
+// columns of a segment becomes one window. A window is rendered in bands that
+// fit one of the ping-pong buffers (9 rows at full width) and streamed through
+// a single RAMWR, so the number of windows follows the painted area rather than
+// the number of commands. Pixels that no command paints are never written.
+
+typedef struct {
+    display_rect_t rect;
+    const display_command_t *text;  // DRAW_TEXT the piece shows, NULL for a solid one
+    uint16_t color;
+} display_piece_t;
+
+typedef struct {
+    uint16_t left;
+    uint16_t right;
+} display_span_t;
+
+// A DRAW_RECT is the largest command, it is made of five fills
+#define DISPLAY_BAND_PIECES     (DISPLAY_COMPOSITOR_BATCH * 5)
+
+// Glyph pixels decoded at once when a glyph row is cut by the window
+#define DISPLAY_BAND_LINE       32
+
+static display_piece_t display_pieces[DISPLAY_BAND_PIECES];
+static size_t display_piece_count;
+static display_span_t display_spans[2][DISPLAY_BAND_PIECES];
+
+// Clipped like the window of a direct fill
+static void _display_add_piece(size_t left, size_t right, size_t top, size_t bottom, uint16_t color, const display_command_t *text) {
+    display_rect_t rect;
+    if (!_display_clip_rect(left, right, top, bottom, &display_clip, &rect)) return;
+
+    display_pieces[display_piece_count++] = (display_piece_t) { rect, text, color };
+}
+
+static void _display_add_command(const display_command_t *command) {
+    display_rect_t rect;
+
+    switch (command->id) {
+    case DISPLAY_COMMAND_FILL_SCREEN:
+        _display_add_piece(0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1, command->fill_screen.color, NULL);
+        break;
+
+    case DISPLAY_COMMAND_FILL_RECT:
+        _display_add_piece(command->fill_rect.left, command->fill_rect.right, command->fill_rect.top, command->fill_rect.bottom, command->fill_rect.color, NULL);
+        break;
+
+    case DISPLAY_COMMAND_DRAW_RECT: {
+        display_rect_t parts[5];
+        uint16_t colors[5];
+        size_t count = _display_rect_parts(&command->draw_rect, parts, colors);
+        for (size_t i = 0; i < count; i++) {
+            _display_add_piece(parts[i].left, parts[i].right, parts[i].top, parts[i].bottom, colors[i], NULL);
+        }
+        break;
+    }
+
+    case DISPLAY_COMMAND_DRAW_TEXT:
+        if (_display_command_rect(command, &rect)) {
+            _display_add_piece(rect.left, rect.right, rect.top, rect.bottom, command->draw_text.back_color, command);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Columns painted in row y as sorted, disjoint runs
+static size_t _display_row_spans(size_t y, display_span_t *spans) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < display_piece_count; i++) {
+        const display_rect_t *rect = &display_pieces[i].rect;
+        if (y < rect->top || y > rect->bottom) continue;
+
+        size_t j = count++;
+        for (; j > 0 && spans[j - 1].left > rect->left; j--) spans[j] = spans[j - 1];
+        spans[j] = (display_span_t) { rect->left, rect->right };
+    }
+
+    size_t merged = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (merged > 0 && spans[i].left <= spans[merged - 1].right + 1) {
+            spans[merged - 1].right = max(spans[merged - 1].right, spans[i].right);
+        } else {
+            spans[merged++] = spans[i];
+        }
+    }
+    return merged;
+}
+
+// Draw the text piece into the part of the buffer inside clip. The buffer
+// holds rows of stride pixels starting at column left of row top.
+static void _display_band_text(uint16_t *buffer, size_t stride, size_t left, size_t top, const display_rect_t *clip, const display_command_t *command) {
+    const draw_text_t *text = &command->draw_text;
+    const font_t *font = text->font;
+    const wchar_t *chars = _display_command_text(command);
+    static uint16_t line[DISPLAY_BAND_LINE];
+
+    _display_build_alpha_lut(text->fore_color, text->back_color);
+
+    for (size_t i = (clip->left - text->left) / font->width; i <= (size_t) (clip->right - text->left) / font->width; i++) {
+        size_t cell = text->left + i * font->width;
+        size_t x0 = max(clip->left, cell);
+        size_t x1 = min(clip->right, cell + font->width - 1);
+        gliph_decoder_t decoder;
+
+        _display_gliph_decoder_init(&decoder, font_gliph(font, chars[i]));
+        const gliph_box_t box = decoder.box;
+        size_t ink_left = cell + box.left;
+
+        // Rows of the ink box above the clip
+        size_t first = clip->top - text->top;
+        if (box.width > 0 && first > box.top) {
+            _display_skip_gliph(&decoder, (min(first, (size_t) box.top + box.height) - box.top) * box.width);
+        }
+
+        for (size_t y = clip->top; y <= clip->bottom; y++) {
+            uint16_t *row = &buffer[(y - top) * stride];
+            size_t cy = y - text->top;
+
+            for (size_t x = x0; x <= x1; x++) row[x - left] = text->back_color;
+            if (box.width == 0 || cy < box.top || cy >= (size_t) box.top + box.height) continue;
+
+            if (ink_left >= x0 && ink_left + box.width - 1 <= x1) {
+                _display_decode_gliph(&decoder, &row[ink_left - left], box.width);
+                continue;
+            }
+
+            // Cut by the window, decode the whole row and keep what is inside
+            for (size_t x = ink_left; x < ink_left + box.width; x += DISPLAY_BAND_LINE) {
+                size_t count = min((size_t) DISPLAY_BAND_LINE, ink_left + box.width - x);
+                _display_decode_gliph(&decoder, line, count);
+                for (size_t k = 0; k < count; k++) {
+                    if (x + k >= x0 && x + k <= x1) row[x + k - left] = line[k];
+                }
+            }
+        }
+    }
+}
+
+// Rows [row, row + rows) of the window, every piece in command order
+static void _display_render_band(uint16_t *buffer, const display_rect_t *window, size_t row, size_t rows) {
+    const display_rect_t band = { window->left, window->right, row, row + rows - 1 };
+    const size_t stride = window->right - window->left + 1;
+
+    for (size_t i = 0; i < display_piece_count; i++) {
+        const display_piece_t *piece = &display_pieces[i];
+        if (!_display_rect_intersects(&piece->rect, &band)) continue;
+
+        display_rect_t clip = {
+            max(piece->rect.left, band.left), min(piece->rect.right, band.right),
+            max(piece->rect.top, band.top), min(piece->rect.bottom, band.bottom)
+        };
+
+        if (piece->text != NULL) {
+            _display_band_text(buffer, stride, band.left, band.top, &clip, piece->text);
+            continue;
+        }
+
+        for (size_t y = clip.top; y <= clip.bottom; y++) {
+            uint16_t *pixel = &buffer[(y - band.top) * stride + clip.left - band.left];
+            for (size_t x = clip.left; x <= clip.right; x++) *pixel++ = piece->color;
+        }
+    }
+}
+
+static void _display_render_window(const display_rect_t *window) {
+    const display_piece_t *only = NULL;
+    size_t pieces = 0;
+
+    for (size_t i = 0; i < display_piece_count; i++) {
+        if (!_display_rect_intersects(&display_pieces[i].rect, window)) continue;
+        only = &display_pieces[i];
+        pieces++;
+    }
+
+    // A window painted by a single fill needs no buffer
+    if (pieces == 1 && only->text == NULL) {
+        _display_color_fill_dma(window->left, window->right, window->top, window->bottom, only->color);
+        return;
+    }
+
+    size_t width = window->right - window->left + 1;
+    size_t band = max(FONT_MAX_GLIPH_SIZE / width, 1);
+    size_t current = 0;
+    size_t row = window->top;
+    size_t rows = min(band, (size_t) (window->bottom - window->top + 1));
+
+    _display_set_window(window->left, window->right, window->top, window->bottom);
+    _display_render_band(display_dma_buffer[current], window, row, rows);
+
+    while (rows > 0) {
+        size_t next = row + rows;
+        size_t next_rows = min(band, window->bottom + 1 - next);
+
+        display_dma_pixels_to_transfer = rows * width;
+        _display_dma_start(display_dma_buffer[current], true, next_rows == 0);
+
+        current ^= 1;
+        if (next_rows > 0) _display_render_band(display_dma_buffer[current], window, next, next_rows);
+
+        _display_wait_dma();
+        row = next;
+        rows = next_rows;
+    }
+}
+
+static void _display_render_segment(const display_span_t *spans, size_t count, size_t top, size_t bottom) {
+    for (size_t i = 0; i < count; i++) {
+        const display_rect_t window = { spans[i].left, spans[i].right, top, bottom };
+        _display_render_window(&window);
+    }
+}
+
+void _display_render_bands(display_command_t **commands, size_t count) {
+    display_piece_count = 0;
+    for (size_t i = 0; i < count; i++) _display_add_command(commands[i]);
+    if (display_piece_count == 0) return;
+
+    size_t y = DISPLAY_HEIGHT;
+    for (size_t i = 0; i < display_piece_count; i++) y = min(y, (size_t) display_pieces[i].rect.top);
+
+    // Pieces start and end only at breakpoints, the spans are the same for
+    // every row between two of them
+    size_t pending = 0;
+    size_t pending_count = 0;
+    size_t pending_top = 0;
+    size_t pending_bottom = 0;
+
+    for (;;) {
+        size_t next = SIZE_MAX;
+        for (size_t i = 0; i < display_piece_count; i++) {
+            const display_rect_t *rect = &display_pieces[i].rect;
+            if (rect->top > y) next = min(next, (size_t) rect->top);
+            if (rect->bottom + 1u > y) next = min(next, rect->bottom + 1u);
+        }
+        if (next == SIZE_MAX) break;
+
+        display_span_t *spans = display_spans[pending ^ 1];
+        size_t spans_count = _display_row_spans(y, spans);
+
+        if (pending_count > 0 && pending_count == spans_count && pending_bottom + 1 == y
+            && memcmp(display_spans[pending], spans, spans_count * sizeof(spans[0])) == 0) {
+            pending_bottom = next - 1;
+        } else {
+            _display_render_segment(display_spans[pending], pending_count, pending_top, pending_bottom);
+            pending ^= 1;
+            pending_count  = spans_count;
+            pending_top    = y;
+            pending_bottom = next - 1;
+        }
+        y = next;
+    }
+
+    _display_render_segment(display_spans[pending], pending_count, pending_top, pending_bottom);
+}
+
+void display_set_render_mode(display_render_mode_t mode) {
+    display_render_mode = mode;
+}
+
+// Takes effect with the next round of drawing
+void display_set_vsync(display_vsync_t mode) {
+    display_vsync = mode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////// TASK ///
+
+static bool _display_text_inside(const display_command_t *command) {
+    const draw_text_t *text = &command->draw_text;
+    size_t right  = text->left + text->length * text->font->width - 1;
+    size_t bottom = text->top + text->font->height - 1;
+    return text->left >= display_clip.left && right <= display_clip.right && text->top >= display_clip.top && bottom <= display_clip.bottom;
+}
+
+void _display_execute(display_command_t *command) {
+    switch (command->id) {
+    case DISPLAY_COMMAND_FILL_SCREEN:
+        _display_fill_screen_dma(
+            command->fill_screen.color
+        );
+        break;
+    
+    case DISPLAY_COMMAND_FILL_RECT:
+        _display_color_fill_dma(
+            command->fill_rect.left,
+            command->fill_rect.right,
+            command->fill_rect.top,
+            command->fill_rect.bottom,
+            command->fill_rect.color
+        );
+        break;
+
+    case DISPLAY_COMMAND_DRAW_RECT:
+        _display_draw_rect(&command->draw_rect);
+        break;
+
+    case DISPLAY_COMMAND_ROUND_RECT:
+    case DISPLAY_COMMAND_DRAW_ARC:
+        _display_draw_shape(command);
+        break;
+
+    case DISPLAY_COMMAND_DRAW_IMAGE:
+        _display_draw_image(&command->draw_image);
+        break;
+
+    case DISPLAY_COMMAND_SCROLL_AREA: {
+        uint16_t top = command->scroll_area.top + DISPLAY_OFFSET_Y;
+        uint16_t areas[3] = { top, command->scroll_area.lines, ST7789_LINES - top - command->scroll_area.lines };
+        _display_write_words(ST7789_VSCRDEF, areas, 3);
+        break;
+    }
+
+    case DISPLAY_COMMAND_SCROLL: {
+        uint16_t line = command->scroll.line + DISPLAY_OFFSET_Y;
+        _display_write_words(ST7789_VSCSAD, &line, 1);
+        break;
+    }
+
+    case DISPLAY_COMMAND_CLIP:
+        display_clip = (display_rect_t) { command->clip.left, command->clip.right, command->clip.top, command->clip.bottom };
+        break;
+
+    case DISPLAY_COMMAND_DRAW_TEXT:
+        // Text cut by the clip is rasterized like a band, only what shows is sent
+        if (!_display_text_inside(command)) {
+            _display_render_bands(&command, 1);
+            break;
+        }
+        _display_draw_text(
+            command->draw_text.font,
+            command->draw_text.left,
+            command->draw_text.top,
+            command->draw_text.fore_color,
+            command->draw_text.back_color,
+            _display_command_text(command),
+            command->draw_text.length
+        );
+        break;
+
+    default:
+        break;
+    }
+}
+
+void _display_task(void *pvParameters) {
+    (void) pvParameters;
+
+    display_set_backlight(100);
+    _display_init();
+    
+    display_power_activity = xTaskGetTickCount();
+
+    for (;;) {
+        if (xSemaphoreTake(hDisplayRingData, _display_power_timeout(xTaskGetTickCount())) != pdPASS) {
+            _display_power_enter();
+            continue;
+        }
+
+        // Input cuts the wait for the next low power refresh short
+        TickType_t hold = _display_power_hold(xTaskGetTickCount());
+        if (hold > 0) xSemaphoreTake(hDisplayWake, hold);
+
+        display_stats.wakeups++;
+        _display_power_update(false);
+        while (_display_compose());
     }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////// SETUP ///
 
 void display_setup() {
-    hDisplayQueue = xQueueCreate(16, sizeof(display_command_t));
-    if (hDisplayQueue == NULL) {
-        ASSERT("Display command queue creation failed.");
-    }
+    hDisplayRingData  = xSemaphoreCreateBinaryStatic(&display_ring_semaphores[0]);
+    hDisplayRingSpace = xSemaphoreCreateBinaryStatic(&display_ring_semaphores[1]);
+    hDisplayRingLock  = xSemaphoreCreateMutexStatic(&display_ring_semaphores[2]);
+    hDisplayFenceDone = xSemaphoreCreateBinaryStatic(&display_ring_semaphores[3]);
+    hDisplayWake      = xSemaphoreCreateBinaryStatic(&display_power_semaphore);
 
     if (xTaskCreate(_display_task, "Display", 256, NULL, 1, &hDisplayTask) != pdPASS) {
         ASSERT("Display task creation failed.");
@@ -509,56 +2461,416 @@ void display_setup() {
 
 /////////////////////////////////////////////////////////////////////////////////////// API ///
 
-void display_fill_screen(uint16_t color) {
-    display_command_t command;
-    command.id                        = DISPLAY_COMMAND_FILL_SCREEN;
-    command.fill_screen.color         = color;
-    xQueueSend(hDisplayQueue, &command, portMAX_DELAY);
-}
-
-void display_fill_rect(uint16_t color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom) {
-    display_command_t command;
-    command.id                        = DISPLAY_COMMAND_FILL_RECT;
-    command.fill_rect.color           = color;
-    command.fill_rect.left            = left;
-    command.fill_rect.right           = right;
-    command.fill_rect.top             = top;
-    command.fill_rect.bottom          = bottom;
-    xQueueSend(hDisplayQueue, &command, portMAX_DELAY);
-}
-
-void display_draw_rect(uint16_t color, uint16_t border_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom) {
-    display_command_t command;
-    command.id                        = DISPLAY_COMMAND_DRAW_RECT;
-    command.draw_rect.color           = color;
-    command.draw_rect.border_color    = border_color;
-    command.draw_rect.left            = left + 1;
-    command.draw_rect.right           = right - 1;
-    command.draw_rect.top             = top - 1;
-    command.draw_rect.bottom          = bottom + 1;
-    xQueueSend(hDisplayQueue, &command, portMAX_DELAY);
-}
-
-void display_draw_text(const font_t *font, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, wchar_t *text) {
+void display_get_stats(display_stats_t *stats) {
+    taskENTER_CRITICAL();
+    *stats = display_stats;
+    stats->queue_depth = display_fence_submitted - display_fence_completed;
+    stats->frame_us = display_vsync_period / (configCPU_CLOCK_HZ / 1000000);
+#if DISPLAY_GLIPH_CACHE_SIZE > 0
+    stats->gliph_cache_bytes = display_gliph_cache_used * sizeof(uint16_t);
+    stats->gliph_cache_entries = display_gliph_entry_count;
+#endif
+    taskEXIT_CRITICAL();
+}
+
+// Rows of the status strip that stays on in low power and the ticks without
+// drawing outside of it after which the panel goes there, 0 to stay in normal
+// mode
+void display_set_power_policy(uint16_t top, uint16_t bottom, TickType_t timeout) {
+    configASSERT(top <= bottom && bottom < DISPLAY_HEIGHT);
+    taskENTER_CRITICAL();
+    display_power_strip   = (display_rect_t) { 0, DISPLAY_WIDTH - 1, top, bottom };
+    display_power_timeout = timeout;
+    taskEXIT_CRITICAL();
+    display_wake();
+}
+
+// Report input: the panel returns to normal mode and the timeout restarts
+void display_wake(void) {
+    display_power_wake = true;
+    xSemaphoreGive(hDisplayWake);
+    xSemaphoreGive(hDisplayRingData);
+}
+
+// Applies to every producer, the timeout only to DISPLAY_POLICY_BLOCK
+void display_set_policy(display_policy_t policy, TickType_t timeout) {
+    xSemaphoreTake(hDisplayRingLock, portMAX_DELAY);
+    display_policy         = policy;
+    display_policy_timeout = timeout;
+    xSemaphoreGive(hDisplayRingLock);
+}
+
+// A dropped command (DISPLAY_FENCE_NONE) has nothing left to wait for
+bool display_fence_reached(display_fence_t fence) {
+    return fence == DISPLAY_FENCE_NONE || (int32_t) (display_fence_completed - fence) >= 0;
+}
+
+// The task notification is taken by the DMA, so waiters sleep on a semaphore
+// the display task gives after each batch. Only one waiter takes it, others
+// look again on the next tick.
+bool display_fence_wait(display_fence_t fence, TickType_t timeout) {
+    TickType_t start = xTaskGetTickCount();
+
+    while (!display_fence_reached(fence)) {
+        if (timeout != portMAX_DELAY && xTaskGetTickCount() - start >= timeout) return false;
+        xSemaphoreTake(hDisplayFenceDone, 1);
+    }
+    return true;
+}
+
+static void _display_record_fill_screen(display_command_t *command, uint16_t color) {
+    command->fill_screen.color        = color;
+}
+
+static void _display_record_fill_rect(display_command_t *command, uint16_t color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom) {
+    command->fill_rect.color          = color;
+    command->fill_rect.left           = left;
+    command->fill_rect.right          = right;
+    command->fill_rect.top            = top;
+    command->fill_rect.bottom         = bottom;
+}
+
+static void _display_record_draw_rect(display_command_t *command, uint16_t color, uint16_t border_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t border) {
+    command->draw_rect.color          = color;
+    command->draw_rect.border_color   = border_color;
+    command->draw_rect.left           = left;
+    command->draw_rect.right          = right;
+    command->draw_rect.top            = top;
+    command->draw_rect.bottom         = bottom;
+    command->draw_rect.border         = border;
+}
+
+static void _display_record_round_rect(display_command_t *command, uint16_t color, uint16_t back_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t radius) {
+    command->round_rect.color         = color;
+    command->round_rect.back_color    = back_color;
+    command->round_rect.left          = left;
+    command->round_rect.right         = right;
+    command->round_rect.top           = top;
+    command->round_rect.bottom        = bottom;
+    command->round_rect.radius        = radius;
+}
+
+// Degrees from start clockwise to end. Equal angles or a difference of a whole
+// number of turns are the full circle.
+static uint16_t _display_arc_sweep(uint16_t start, uint16_t end) {
+    uint16_t sweep = (end % 360 + 360 - start % 360) % 360;
+    return sweep == 0 ? 360 : sweep;
+}
+
+static void _display_record_draw_arc(display_command_t *command, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, uint16_t radius, uint16_t thickness, uint16_t start, uint16_t end) {
+    command->draw_arc.color           = color;
+    command->draw_arc.back_color      = back_color;
+    command->draw_arc.x               = x;
+    command->draw_arc.y               = y;
+    command->draw_arc.radius          = radius;
+    command->draw_arc.thickness       = thickness;
+    command->draw_arc.start           = start % 360;
+    command->draw_arc.end             = start % 360 + _display_arc_sweep(start, end);
+}
+
+static void _display_record_draw_text(display_command_t *command, const font_t *font, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, const wchar_t *text, size_t length) {
+    command->draw_text.font           = font;
+    command->draw_text.left           = x;
+    command->draw_text.top            = y;
+    command->draw_text.fore_color     = color;
+    command->draw_text.back_color     = back_color;
+    command->draw_text.length         = length;
+    wmemcpy(_display_command_text(command), text, length);
+}
+
+display_fence_t display_fill_screen(uint16_t color) {
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_FILL_SCREEN, DISPLAY_RECORD_SIZE(fill_screen));
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    _display_record_fill_screen(command, color);
+    return _display_ring_commit(command);
+}
+
+display_fence_t display_fill_rect(uint16_t color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom) {
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_FILL_RECT, DISPLAY_RECORD_SIZE(fill_rect));
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    _display_record_fill_rect(command, color, left, right, top, bottom);
+    return _display_ring_commit(command);
+}
+
+// The rectangle [left, right] x [top, bottom] in color, with a border of the
+// given thickness inside those bounds. Every pixel is sent once.
+display_fence_t display_draw_rect(uint16_t color, uint16_t border_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t border) {
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_DRAW_RECT, DISPLAY_RECORD_SIZE(draw_rect));
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    _display_record_draw_rect(command, color, border_color, left, right, top, bottom, border);
+    return _display_ring_commit(command);
+}
+
+// Shapes blend their antialiased edge with back_color, the color they are
+// drawn on, and leave the pixels around them as they are
+display_fence_t display_fill_round_rect(uint16_t color, uint16_t back_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t radius) {
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_ROUND_RECT, DISPLAY_RECORD_SIZE(round_rect));
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    _display_record_round_rect(command, color, back_color, left, right, top, bottom, radius);
+    return _display_ring_commit(command);
+}
+
+// Angles in degrees clockwise from 12 o'clock, the arc runs from start to end
+// past 360 if it has to. Equal angles draw the whole ring.
+display_fence_t display_draw_arc(uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, uint16_t radius, uint16_t thickness, uint16_t start, uint16_t end) {
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_DRAW_ARC, DISPLAY_RECORD_SIZE(draw_arc));
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    _display_record_draw_arc(command, color, back_color, x, y, radius, thickness, start, end);
+    return _display_ring_commit(command);
+}
+
+display_fence_t display_fill_circle(uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, uint16_t radius) {
+    return display_draw_arc(color, back_color, x, y, radius, radius + 1, 0, 360);
+}
+
+static void _display_record_draw_image(display_command_t *command, const image_t *image, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y) {
+    command->draw_image.image         = image;
+    command->draw_image.fore_color    = color;
+    command->draw_image.back_color    = back_color;
+    command->draw_image.left          = x;
+    command->draw_image.top           = y;
+}
+
+// The image paints all of its pixels, color and back_color tint alpha images
+display_fence_t display_draw_image(const image_t *image, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y) {
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_DRAW_IMAGE, DISPLAY_RECORD_SIZE(draw_image));
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    _display_record_draw_image(command, image, color, back_color, x, y);
+    return _display_ring_commit(command);
+}
+
+static void _display_record_scroll_area(display_command_t *command, uint16_t top, uint16_t lines) {
+    command->scroll_area.top          = top;
+    command->scroll_area.lines        = lines;
+}
+
+static void _display_record_scroll(display_command_t *command, uint16_t line) {
+    command->scroll.line              = line;
+}
+
+// Rows [top, top + lines) scroll, the rows around them stay in place. Drawing
+// keeps using GRAM rows: row y of the area is on screen at
+// top + (y - line) mod lines once display_scroll(line) is applied.
+display_fence_t display_set_scroll_area(uint16_t top, uint16_t lines) {
+    configASSERT(top + lines <= DISPLAY_HEIGHT);
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_SCROLL_AREA, DISPLAY_RECORD_SIZE(scroll_area));
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    _display_record_scroll_area(command, top, lines);
+    return _display_ring_commit(command);
+}
+
+// Show GRAM row line at the top of the scroll area
+display_fence_t display_scroll(uint16_t line) {
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_SCROLL, DISPLAY_RECORD_SIZE(scroll));
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    _display_record_scroll(command, line);
+    return _display_ring_commit(command);
+}
+
+static void _display_record_clip(display_command_t *command, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom) {
+    command->clip.left                = left;
+    command->clip.right               = right;
+    command->clip.top                 = top;
+    command->clip.bottom              = bottom;
+}
+
+// Drawing submitted after it only changes pixels inside the rectangle, the
+// rest of every primitive is trimmed before it reaches the bus. The whole
+// panel, 0, DISPLAY_WIDTH - 1, 0, DISPLAY_HEIGHT - 1, lifts the clip.
+display_fence_t display_set_clip(uint16_t left, uint16_t right, uint16_t top, uint16_t bottom) {
+    configASSERT(left <= right && top <= bottom);
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_CLIP, DISPLAY_RECORD_SIZE(clip));
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    _display_record_clip(command, left, right, top, bottom);
+    return _display_ring_commit(command);
+}
+
+// The whole string is one command, unless it is too long for the ring. The
+// fence is the one of the last part, DISPLAY_FENCE_NONE if any part was lost.
+display_fence_t display_draw_text(const font_t *font, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, const wchar_t *text) {
+    const size_t capacity = (DISPLAY_RING_SIZE / 2 - DISPLAY_RECORD_SIZE(draw_text)) / sizeof(wchar_t);
     size_t length = wcslen(text);
-    display_command_t command;
-    command.id                        = DISPLAY_COMMAND_DRAW_TEXT;
-    command.draw_text.font            = font;
-    command.draw_text.left            = x;
-    command.draw_text.top             = y;
-    command.draw_text.fore_color      = color;
-    command.draw_text.back_color      = back_color;
+    bool lost = false;
+    display_fence_t fence;
+
+    do {
+        size_t count = min(length, capacity);
+        display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_DRAW_TEXT, DISPLAY_RECORD_SIZE(draw_text) + count * sizeof(wchar_t));
+        if (command != NULL) {
+            _display_record_draw_text(command, font, color, back_color, x, y, text, count);
+            fence = _display_ring_commit(command);
+        } else {
+            fence = DISPLAY_FENCE_NONE;
+        }
+        lost |= fence == DISPLAY_FENCE_NONE;
 
-    for (;;) {
-        size_t len = min(length, sizeof(command.draw_text.text) / sizeof(command.draw_text.text[0]));
-        memcpy(command.draw_text.text, text, len * sizeof(command.draw_text.text[0]));
-        if (len < sizeof(command.draw_text.text)) command.draw_text.text[len] = 0;
-        xQueueSend(hDisplayQueue, &command, portMAX_DELAY);
-        length -= len;
-        if (length <= 0) break;
-        text += len;
-        command.draw_text.left += len * font->width;
+        x      += count * font->width;
+        text   += count;
+        length -= count;
+    } while (length > 0);
+
+    return lost ? DISPLAY_FENCE_NONE : fence;
+}
+
+////////////////////////////////////////////////////////////////////////////// DISPLAY LIST ///
+
+// Commands are recorded in the same format as in the ring, submitting copies
+// them behind a single LIST record: one lock, one commit and one wake-up of
+// the display task for the whole screen.
+
+_Static_assert(DISPLAY_LIST_SIZE % DISPLAY_RECORD_ALIGNMENT == 0 && _Alignof(max_align_t) >= DISPLAY_RECORD_ALIGNMENT, "display list records must be aligned like the ring");
+
+static display_command_t *_display_list_reserve(display_list_t *list, uint8_t id, size_t size) {
+    size = DISPLAY_RECORD_ALIGN(size);
+    if (list->count == DISPLAY_LIST_COMMANDS || list->size + size > DISPLAY_LIST_SIZE) return NULL;
+
+    display_command_t *command = (display_command_t *) &list->records[list->size];
+    command->id   = id;
+    command->size = size;
+    list->size   += size;
+    list->count++;
+    return command;
+}
+
+void display_list_begin(display_list_t *list) {
+    list->size  = 0;
+    list->count = 0;
+}
+
+// The display_list_* calls return false when the list is full, the command is
+// not recorded then
+bool display_list_fill_screen(display_list_t *list, uint16_t color) {
+    display_command_t *command = _display_list_reserve(list, DISPLAY_COMMAND_FILL_SCREEN, DISPLAY_RECORD_SIZE(fill_screen));
+    if (command == NULL) return false;
+    _display_record_fill_screen(command, color);
+    return true;
+}
+
+bool display_list_fill_rect(display_list_t *list, uint16_t color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom) {
+    display_command_t *command = _display_list_reserve(list, DISPLAY_COMMAND_FILL_RECT, DISPLAY_RECORD_SIZE(fill_rect));
+    if (command == NULL) return false;
+    _display_record_fill_rect(command, color, left, right, top, bottom);
+    return true;
+}
+
+bool display_list_draw_rect(display_list_t *list, uint16_t color, uint16_t border_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t border) {
+    display_command_t *command = _display_list_reserve(list, DISPLAY_COMMAND_DRAW_RECT, DISPLAY_RECORD_SIZE(draw_rect));
+    if (command == NULL) return false;
+    _display_record_draw_rect(command, color, border_color, left, right, top, bottom, border);
+    return true;
+}
+
+bool display_list_fill_round_rect(display_list_t *list, uint16_t color, uint16_t back_color, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t radius) {
+    display_command_t *command = _display_list_reserve(list, DISPLAY_COMMAND_ROUND_RECT, DISPLAY_RECORD_SIZE(round_rect));
+    if (command == NULL) return false;
+    _display_record_round_rect(command, color, back_color, left, right, top, bottom, radius);
+    return true;
+}
+
+bool display_list_draw_arc(display_list_t *list, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, uint16_t radius, uint16_t thickness, uint16_t start, uint16_t end) {
+    display_command_t *command = _display_list_reserve(list, DISPLAY_COMMAND_DRAW_ARC, DISPLAY_RECORD_SIZE(draw_arc));
+    if (command == NULL) return false;
+    _display_record_draw_arc(command, color, back_color, x, y, radius, thickness, start, end);
+    return true;
+}
+
+bool display_list_fill_circle(display_list_t *list, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, uint16_t radius) {
+    return display_list_draw_arc(list, color, back_color, x, y, radius, radius + 1, 0, 360);
+}
+
+bool display_list_draw_text(display_list_t *list, const font_t *font, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y, const wchar_t *text) {
+    size_t length = wcslen(text);
+    display_command_t *command = _display_list_reserve(list, DISPLAY_COMMAND_DRAW_TEXT, DISPLAY_RECORD_SIZE(draw_text) + length * sizeof(wchar_t));
+    if (command == NULL) return false;
+    _display_record_draw_text(command, font, color, back_color, x, y, text, length);
+    return true;
+}
+
+bool display_list_draw_image(display_list_t *list, const image_t *image, uint16_t color, uint16_t back_color, uint16_t x, uint16_t y) {
+    display_command_t *command = _display_list_reserve(list, DISPLAY_COMMAND_DRAW_IMAGE, DISPLAY_RECORD_SIZE(draw_image));
+    if (command == NULL) return false;
+    _display_record_draw_image(command, image, color, back_color, x, y);
+    return true;
+}
+
+bool display_list_set_clip(display_list_t *list, uint16_t left, uint16_t right, uint16_t top, uint16_t bottom) {
+    configASSERT(left <= right && top <= bottom);
+    display_command_t *command = _display_list_reserve(list, DISPLAY_COMMAND_CLIP, DISPLAY_RECORD_SIZE(clip));
+    if (command == NULL) return false;
+    _display_record_clip(command, left, right, top, bottom);
+    return true;
+}
+
+bool display_list_scroll(display_list_t *list, uint16_t line) {
+    display_command_t *command = _display_list_reserve(list, DISPLAY_COMMAND_SCROLL, DISPLAY_RECORD_SIZE(scroll));
+    if (command == NULL) return false;
+    _display_record_scroll(command, line);
+    return true;
+}
+
+// Queue everything recorded since display_list_begin(), the list can be
+// reused right away
+display_fence_t display_list_submit(display_list_t *list) {
+    if (list->count == 0) return DISPLAY_FENCE_NONE;
+
+    display_command_t *command = _display_ring_reserve(DISPLAY_COMMAND_LIST, DISPLAY_RECORD_SIZE(list) + list->size);
+    if (command == NULL) return DISPLAY_FENCE_NONE;
+    command->list.count = list->count;
+    memcpy(_display_list_records(command), list->records, list->size);
+    return _display_ring_commit(command);
+}
+
+//////////////////////////////////////////////////////////////////////////////// TEXT FIELD ///
+
+void display_text_field_init(display_text_field_t *field, const font_t *font, uint16_t x, uint16_t y, size_t cells) {
+    field->font  = font;
+    field->left  = x;
+    field->top   = y;
+    field->cells = min(cells, DISPLAY_TEXT_FIELD_CELLS);
+    field->valid = false;
+}
+
+// The next update redraws every cell, e.g. after the screen was cleared
+void display_text_field_invalidate(display_text_field_t *field) {
+    field->valid = false;
+}
+
+// Show the text, padded with spaces to the field width, and return the number
+// of cells sent. Each run of changed cells goes out as one DRAW_TEXT.
+size_t display_text_field_set(display_text_field_t *field, uint16_t color, uint16_t back_color, const wchar_t *text) {
+    wchar_t run[DISPLAY_TEXT_FIELD_CELLS + 1];
+    size_t length = 0;
+    size_t sent = 0;
+    size_t start = 0;
+
+    for (size_t i = 0; i <= field->cells; i++) {
+        bool changed = false;
+
+        if (i < field->cells) {
+            wchar_t ch = (text != NULL && *text) ? *text++ : L' ';
+            changed = !field->valid || field->text[i] != ch || field->fore_color[i] != color || field->back_color[i] != back_color;
+            field->text[i]       = ch;
+            field->fore_color[i] = color;
+            field->back_color[i] = back_color;
+        }
+
+        if (changed) {
+            if (length == 0) start = i;
+            run[length++] = field->text[i];
+        } else if (length > 0) {
+            run[length] = 0;
+            if (display_draw_text(field->font, color, back_color, field->left + start * field->font->width, field->top, run) == DISPLAY_FENCE_NONE) {
+                // Never matches a character, so these cells go out again on the next update
+                for (size_t j = start; j < i; j++) field->text[j] = 0;
+            } else {
+                sent += length;
+            }
+            length = 0;
+        }
     }
+
+    field->valid = true;
+    return sent;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////// END ///
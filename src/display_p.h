@@ -5,12 +5,24 @@
 #include <stddef.h>
 
 #include "fonts.h"
+#include "display.h"
 
 #define DISPLAY_COMMAND_FILL_SCREEN   0x00
 #define DISPLAY_COMMAND_FILL_RECT     0x01
 #define DISPLAY_COMMAND_DRAW_RECT     0x02
+#define DISPLAY_COMMAND_ROUND_RECT    0x03
+#define DISPLAY_COMMAND_DRAW_ARC      0x04
 
 #define DISPLAY_COMMAND_DRAW_TEXT     0x10
+#define DISPLAY_COMMAND_DRAW_IMAGE    0x11
+
+#define DISPLAY_COMMAND_LIST          0x20
+
+#define DISPLAY_COMMAND_SCROLL_AREA   0x30
+#define DISPLAY_COMMAND_SCROLL        0x31
+#define DISPLAY_COMMAND_CLIP          0x32
+
+#define DISPLAY_COMMAND_PAD           0xFF
 
 typedef struct {
     uint16_t color;
@@ -24,6 +36,7 @@ typedef struct {
     uint16_t bottom;
 } fill_rect_t;
 
+// Outer bounds, the border lies inside them
 typedef struct {
     uint16_t color;
     uint16_t border_color;
@@ -31,27 +44,149 @@ typedef struct {
     uint16_t right;
     uint16_t top;
     uint16_t bottom;
+    uint16_t border;        // Thickness, 0 is a plain fill
 } draw_rect_t;
 
+// Corners of the radius are rounded off. The edge is blended with back_color,
+// pixels outside the shape are left as they are.
+typedef struct {
+    uint16_t color;
+    uint16_t back_color;
+    uint16_t left;
+    uint16_t right;
+    uint16_t top;
+    uint16_t bottom;
+    uint16_t radius;
+} round_rect_t;
+
+// Ring of the given thickness inside the radius, from start clockwise to end
+// in degrees, 0 is 12 o'clock. A span of 360 or more is the whole ring, a
+// thickness over the radius a disk. Blended and left alone like a round rect.
+typedef struct {
+    uint16_t color;
+    uint16_t back_color;
+    uint16_t x;
+    uint16_t y;
+    uint16_t radius;
+    uint16_t thickness;
+    uint16_t start;
+    uint16_t end;
+} draw_arc_t;
+
+// The text follows the command in the ring, see _display_command_text()
 typedef struct {
     const font_t *font;
     uint16_t fore_color;
     uint16_t back_color;
     uint16_t left;
     uint16_t top;
-    wchar_t text[16];
+    uint16_t length;
 } draw_text_t;
 
+// Paints the whole image, the colors are only used by IMAGE_FORMAT_ALPHA
+typedef struct {
+    const image_t *image;
+    uint16_t fore_color;
+    uint16_t back_color;
+    uint16_t left;
+    uint16_t top;
+} draw_image_t;
+
+// Rows in GRAM coordinates, which scrolling does not change
+typedef struct {
+    uint16_t top;           // Fixed rows above the scroll area
+    uint16_t lines;         // Rows of the scroll area, the rest below it is fixed
+} scroll_area_t;
+
+typedef struct {
+    uint16_t line;          // GRAM row shown at the top of the scroll area
+} scroll_t;
+
+// Drawing after it only changes pixels inside the rectangle
+typedef struct {
+    uint16_t left;
+    uint16_t right;
+    uint16_t top;
+    uint16_t bottom;
+} clip_t;
+
+// The records of a display list follow the command, see _display_list_records()
+typedef struct {
+    uint16_t count;
+} draw_list_t;
+
+// Commands are records of variable length in the command ring: a command only
+// takes the header and the member for its id, plus the text for DRAW_TEXT.
 typedef struct {
     uint8_t id;
+    uint16_t size;          // Whole record in bytes, a multiple of 4
     union {
         fill_screen_t fill_screen;
         fill_rect_t fill_rect;
         draw_rect_t draw_rect;
+        round_rect_t round_rect;
+        draw_arc_t draw_arc;
         draw_text_t draw_text;
+        draw_image_t draw_image;
+        draw_list_t list;
+        scroll_area_t scroll_area;
+        scroll_t scroll;
+        clip_t clip;
     };
 } display_command_t;
 
+// Records are placed back to back, each one aligned for display_command_t
+#define DISPLAY_RECORD_ALIGNMENT       _Alignof(display_command_t)
+#define DISPLAY_RECORD_ALIGN(size)     (((size) + DISPLAY_RECORD_ALIGNMENT - 1) & ~(size_t) (DISPLAY_RECORD_ALIGNMENT - 1))
+#define DISPLAY_RECORD_SIZE(member)    DISPLAY_RECORD_ALIGN(offsetof(display_command_t, member) + sizeof(((display_command_t *) 0)->member))
+
+static inline wchar_t *_display_command_text(const display_command_t *command) {
+    return (wchar_t *) ((uint8_t *) command + DISPLAY_RECORD_SIZE(draw_text));
+}
+
+static inline display_command_t *_display_list_records(const display_command_t *command) {
+    return (display_command_t *) ((uint8_t *) command + DISPLAY_RECORD_SIZE(list));
+}
+
+// Copy of a record taken out of the ring, longer texts do not fit
+typedef union {
+    display_command_t command;
+    uint8_t bytes[DISPLAY_RECORD_COPY];
+} display_record_t;
+
+typedef struct {
+    uint16_t left;
+    uint16_t right;
+    uint16_t top;
+    uint16_t bottom;
+} display_rect_t;
+
+// Position inside a compressed glyph, each strip continues where the previous
+// one stopped
+typedef struct {
+    const uint8_t *data;    // Next byte of the coded ink box
+    gliph_box_t box;        // Empty for a blank cell
+    uint8_t token;          // Token being expanded
+    uint8_t count;          // Pixels left in it
+    bool low;               // Literal: the next pixel is the low nibble
+} gliph_decoder_t;
+
+typedef struct {
+    const font_t *font;
+    wchar_t ch;
+    uint16_t fore_color;
+    uint16_t back_color;
+} display_gliph_key_t;
+
+// Colorized ink rows of a cell in the glyph cache
+typedef struct {
+    display_gliph_key_t key;
+    uint16_t offset;        // First pixel in the cache
+    uint8_t top;            // First ink row of the cell
+    uint8_t rows;
+    uint32_t used;          // Lookup of the last hit, for LRU eviction
+} display_gliph_entry_t;
+
 typedef union {
     uint32_t raw;
     struct {
@@ -71,13 +206,52 @@ typedef union {
     };        
 } rgb565_t;
 
+size_t _display_vsync_slice(size_t width, size_t rows);
+void _display_vsync_wait(size_t width, size_t top, size_t bottom);
+void _display_vsync_update(void);
 void _display_set_window(size_t left, size_t right, size_t top, size_t bottom);
 void _display_color_fill_dma(size_t left, size_t right, size_t top, size_t bottom, uint16_t color);
 void _display_fill_screen_dma(uint16_t color);
-void _display_copy_dma(size_t left, size_t right, size_t top, size_t bottom);
-void _display_draw_rect(uint16_t left, uint16_t right, uint16_t top, uint16_t bottom, uint16_t fore_color, uint16_t border_color);
-void _display_draw_text(const font_t *font, uint16_t left, uint16_t top, uint16_t fore_color, uint16_t back_color, wchar_t *text, size_t length);
+void _display_copy_dma_start(const uint16_t *buffer, size_t left, size_t right, size_t top, size_t bottom);
+void _display_wait_dma(void);
+void _display_copy_dma(const uint16_t *buffer, size_t left, size_t right, size_t top, size_t bottom);
+void _display_write_words(uint8_t command, const uint16_t *words, size_t count);
+size_t _display_rect_parts(const draw_rect_t *rect, display_rect_t *parts, uint16_t *colors);
+void _display_draw_rect(const draw_rect_t *rect);
+void _display_shape_alpha(const display_command_t *command, size_t y, size_t left, size_t right, uint8_t *alpha);
+void _display_draw_shape(const display_command_t *command);
+void _display_draw_text(const font_t *font, uint16_t left, uint16_t top, uint16_t fore_color, uint16_t back_color, const wchar_t *text, size_t length);
 uint16_t _mix_colors(uint16_t fore_color, uint16_t back_color, uint8_t alpha);
+void _display_build_alpha_lut(uint16_t fore_color, uint16_t back_color);
+void _display_decode_gliph(gliph_decoder_t *decoder, uint16_t *buffer, size_t pixels);
+void _display_skip_gliph(gliph_decoder_t *decoder, size_t pixels);
+void _display_gliph_decoder_init(gliph_decoder_t *decoder, const uint8_t *data);
+void _display_render_text_strip(uint16_t *buffer, const font_t *font, gliph_decoder_t *decoders, size_t count, size_t row, size_t rows, uint16_t back_color);
+void _display_gliph_cache_reset(void);
+void _display_draw_image(const draw_image_t *draw);
+
+extern uint16_t display_dma_buffer[2][FONT_MAX_GLIPH_SIZE];
+extern uint16_t display_alpha_lut[FONT_ALPHA_MAX + 1];
+extern volatile size_t display_ring_head;
+extern volatile size_t display_ring_tail;
+extern display_stats_t display_stats;
+extern bool display_compositor_bypass;
+extern bool display_low_power;
 
 
+void _display_init(void);
+display_command_t *_display_ring_reserve(uint8_t id, size_t size);
+display_fence_t _display_ring_commit(display_command_t *command);
+display_command_t *_display_ring_peek(size_t *position, size_t room);
+void _display_ring_release(size_t position);
+bool _display_command_rect(const display_command_t *command, display_rect_t *rect);
+void _display_execute(display_command_t *command);
+bool _display_compose(void);
+void _display_compositor_reset(void);
+void _display_power_enter(void);
+void _display_power_activity(void);
+TickType_t _display_power_timeout(TickType_t now);
+TickType_t _display_power_hold(TickType_t now);
+void _display_power_update(bool outside);
+void _display_render_bands(display_command_t **commands, size_t count);
 void _display_task(void *pvParameters);
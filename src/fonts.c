@@ -3,10 +3,58 @@
 
 
 const uint8_t *font_gliph(const font_t *font, const wchar_t ch) {
-    const gliph_t *pointer = font->gliph;
-    while (pointer != NULL) {
-        if (pointer->key == ch) return pointer->data;
-        pointer = pointer->next;
+    if (ch >= FONT_ASCII_FIRST && ch <= FONT_ASCII_LAST) {
+        return font->ascii[ch - FONT_ASCII_FIRST];
+    }
+
+    // Binary search over the sorted non-ASCII glyphs
+    size_t low = 0;
+    size_t high = font->gliph_count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        wchar_t key = font->gliph[middle].key;
+        if (key == ch) return font->gliph[middle].data;
+        if (key < ch) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
     }
     return NULL;
 }
+
+// Expand a glyph to width * height bytes of 8-bit alpha. The renderer decodes
+// straight to colors, this is the reference for tools and benchmarks.
+void font_gliph_alpha(const font_t *font, const uint8_t *data, uint8_t *alpha) {
+    const gliph_box_t *box = (const gliph_box_t *) data;
+    size_t size = box->width * box->height;
+    size_t x = 0;
+    size_t y = 0;
+
+    memset(alpha, 0x00, font->width * font->height);
+    data += sizeof(gliph_box_t);
+
+    while (size > 0) {
+        uint8_t token = *data++;
+        bool literal = token & FONT_TOKEN_LITERAL;
+        size_t count = min((size_t) (token & (literal ? FONT_LITERAL_MASK : FONT_RUN_MASK)) + 1, size);
+
+        for (size_t i = 0; i < count; i++) {
+            uint8_t value;
+            if (literal) {
+                value = (i & 1) ? data[i / 2] & 0x0F : data[i / 2] >> 4;
+            } else {
+                value = (token & FONT_TOKEN_FULL) ? FONT_ALPHA_MAX : 0;
+            }
+
+            alpha[(box->top + y) * font->width + box->left + x] = value * 0x11;
+            if (++x == box->width) {
+                x = 0;
+                y++;
+            }
+        }
+
+        if (literal) data += (count + 1) / 2;
+        size -= count;
+    }
+}
@@ -0,0 +1,104 @@
+// This file is auto-generated, do not edit it by hand.
+// Generated 2026-10-17 12:27:27.997042+00:00
+
+#include "images.h"
+
+// icon_heating: 40x40 alpha, 454 bytes, 3200 as RGB565
+static const uint8_t icon_heating_data[] = {
+    0x02, 0x02, 0x24, 0x23, 0x06, 0x81, 0x66, 0x07, 0x81, 0x66, 0x07, 0x81, 0x66, 0x0C, 0x83, 0x6F,
+    0xF9, 0x05, 0x83, 0x6F, 0xF9, 0x05, 0x83, 0x6F, 0xF9, 0x0B, 0x84, 0x6F, 0xEF, 0x90, 0x04, 0x84,
+    0x6F, 0xEF, 0x90, 0x04, 0x84, 0x6F, 0xEF, 0x90, 0x0B, 0x80, 0x90, 0x42, 0x80, 0x60, 0x04, 0x80,
+    0x90, 0x42, 0x80, 0x60, 0x04, 0x80, 0x90, 0x42, 0x80, 0x60, 0x0B, 0x84, 0x8F, 0xFE, 0x10, 0x04,
+    0x84, 0x8F, 0xFE, 0x10, 0x04, 0x84, 0x8F, 0xFE, 0x10, 0x0B, 0x83, 0xBF, 0xF6, 0x05, 0x83, 0xBF,
+    0xF6, 0x05, 0x83, 0xBF, 0xF6, 0x0B, 0x83, 0x6E, 0xF8, 0x05, 0x83, 0x6E, 0xF8, 0x05, 0x83, 0x6E,
+    0xF8, 0x0A, 0x84, 0x1C, 0xFF, 0x50, 0x04, 0x84, 0x1C, 0xFF, 0x50, 0x04, 0x84, 0x1C, 0xFF, 0x50,
+    0x0A, 0x83, 0xAF, 0xFD, 0x05, 0x83, 0xAF, 0xFD, 0x05, 0x83, 0xAF, 0xFD, 0x0A, 0x80, 0xB0, 0x42,
+    0x80, 0x40, 0x04, 0x80, 0xB0, 0x42, 0x80, 0x40, 0x04, 0x80, 0xB0, 0x42, 0x80, 0x40, 0x08, 0x81,
+    0x1B, 0x42, 0x80, 0x60, 0x03, 0x81, 0x1B, 0x42, 0x80, 0x60, 0x03, 0x81, 0x1B, 0x42, 0x80, 0x60,
+    0x09, 0x80, 0xB0, 0x42, 0x80, 0x60, 0x04, 0x80, 0xB0, 0x42, 0x80, 0x60, 0x04, 0x80, 0xB0, 0x42,
+    0x80, 0x60, 0x09, 0x80, 0x80, 0x42, 0x80, 0x60, 0x04, 0x80, 0x80, 0x42, 0x80, 0x60, 0x04, 0x80,
+    0x80, 0x42, 0x80, 0x60, 0x09, 0x80, 0x20, 0x42, 0x80, 0x60, 0x04, 0x80, 0x20, 0x42, 0x80, 0x60,
+    0x04, 0x80, 0x20, 0x42, 0x80, 0x60, 0x0A, 0x83, 0x5F, 0xFA, 0x05, 0x83, 0x5F, 0xFA, 0x05, 0x83,
+    0x5F, 0xFA, 0x0B, 0x83, 0x6F, 0xF9, 0x05, 0x83, 0x6F, 0xF9, 0x05, 0x83, 0x6F, 0xF9, 0x0B, 0x84,
+    0x4F, 0xFD, 0x20, 0x04, 0x84, 0x4F, 0xFD, 0x20, 0x04, 0x84, 0x4F, 0xFD, 0x20, 0x0B, 0x84, 0xBF,
+    0xFC, 0x10, 0x04, 0x84, 0xBF, 0xFC, 0x10, 0x04, 0x84, 0xBF, 0xFC, 0x10, 0x0A, 0x85, 0x2E, 0xFF,
+    0xD2, 0x03, 0x85, 0x2E, 0xFF, 0xD2, 0x03, 0x85, 0x2E, 0xFF, 0xD2, 0x0A, 0x85, 0x4E, 0xFF, 0xD2,
+    0x03, 0x85, 0x4E, 0xFF, 0xD2, 0x03, 0x85, 0x4E, 0xFF, 0xD2, 0x0A, 0x85, 0x4E, 0xFF, 0xD1, 0x03,
+    0x85, 0x4E, 0xFF, 0xD1, 0x03, 0x85, 0x4E, 0xFF, 0xD1, 0x0A, 0x84, 0x3E, 0xFF, 0x90, 0x04, 0x84,
+    0x3E, 0xFF, 0x90, 0x04, 0x84, 0x3E, 0xFF, 0x90, 0x0B, 0x84, 0x4E, 0xFF, 0x30, 0x04, 0x84, 0x4E,
+    0xFF, 0x30, 0x04, 0x84, 0x4E, 0xFF, 0x30, 0x0B, 0x83, 0x9F, 0xF8, 0x05, 0x83, 0x9F, 0xF8, 0x05,
+    0x83, 0x9F, 0xF8, 0x0B, 0x83, 0x6F, 0xF8, 0x05, 0x83, 0x6F, 0xF8, 0x05, 0x83, 0x6F, 0xF8, 0x0C,
+    0x82, 0x78, 0x10, 0x06, 0x82, 0x78, 0x10, 0x06, 0x82, 0x78, 0x10, 0x2A, 0x9C, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x10, 0x04, 0xA3, 0x8D, 0xEE,
+    0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xD9, 0x10, 0x08,
+    0x5F, 0x83, 0xA0, 0x1E, 0x60, 0x82, 0x21, 0xE0, 0x60, 0x82, 0x20, 0x90, 0x5F, 0x85, 0xB0, 0x01,
+    0xAE, 0x5C, 0x81, 0xB1, 0x03, 0x9D, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22,
+    0x22, 0x22, 0x22, 0x22, 0x22, 0x02,
+};
+
+const image_t icon_heating = { .width = 40, .height = 40, .format = IMAGE_FORMAT_ALPHA, .colors = 0, .palette = NULL, .data = icon_heating_data };
+
+// icon_fan: 40x40 alpha, 527 bytes, 3200 as RGB565
+static const uint8_t icon_fan_data[] = {
+    0x01, 0x01, 0x26, 0x26, 0x11, 0x82, 0x11, 0x10, 0x1D, 0x8B, 0x26, 0xAC, 0xDE, 0xED, 0xCA, 0x73,
+    0x17, 0x81, 0x5B, 0x4B, 0x81, 0xC6, 0x13, 0x81, 0x4C, 0x46, 0x83, 0xED, 0xEE, 0x44, 0x81, 0xC5,
+    0x10, 0x80, 0x80, 0x43, 0x8B, 0xEA, 0x73, 0x11, 0x36, 0x79, 0xAD, 0x43, 0x81, 0xA1, 0x0C, 0x81,
+    0x1B, 0x42, 0x88, 0xE7, 0x20, 0x02, 0x8D, 0xE0, 0x42, 0x83, 0xEB, 0xAD, 0x42, 0x81, 0xC2, 0x0A,
+    0x81, 0x1C, 0x42, 0x85, 0xA2, 0x00, 0x19, 0x45, 0x85, 0xD6, 0x30, 0x19, 0x42, 0x81, 0xE2, 0x09,
+    0x80, 0xB0, 0x42, 0x80, 0x60, 0x02, 0x81, 0x2C, 0x45, 0x80, 0x70, 0x05, 0x85, 0x5E, 0xFF, 0xD1,
+    0x07, 0x80, 0x80, 0x42, 0x80, 0x50, 0x02, 0x81, 0x1C, 0x44, 0x81, 0xE4, 0x07, 0x84, 0x4E, 0xFF,
+    0xA0, 0x06, 0x80, 0x40, 0x42, 0x80, 0x60, 0x03, 0x80, 0x70, 0x45, 0x80, 0x50, 0x09, 0x80, 0x50,
+    0x42, 0x80, 0x60, 0x05, 0x83, 0xCF, 0xFA, 0x03, 0x81, 0x1E, 0x44, 0x80, 0x80, 0x0B, 0x84, 0x8F,
+    0xFE, 0x10, 0x03, 0x84, 0x5F, 0xFE, 0x10, 0x03, 0x80, 0x40, 0x44, 0x81, 0xE1, 0x0B, 0x84, 0x1D,
+    0xFF, 0x70, 0x03, 0x83, 0xBF, 0xF8, 0x04, 0x80, 0x60, 0x44, 0x80, 0xA0, 0x0D, 0x83, 0x6F, 0xFD,
+    0x02, 0x84, 0x2F, 0xFE, 0x20, 0x04, 0x80, 0x40, 0x44, 0x80, 0x60, 0x0D, 0x8A, 0x1D, 0xFF, 0x40,
+    0x06, 0xFF, 0xA0, 0x06, 0x80, 0xB0, 0x43, 0x82, 0x51, 0x10, 0x0C, 0x89, 0x9F, 0xF8, 0x00, 0xAF,
+    0xF6, 0x06, 0x90, 0x19, 0xEF, 0xFC, 0xDE, 0xB3, 0x00, 0x17, 0x97, 0x10, 0x03, 0x89, 0x5F, 0xFB,
+    0x00, 0xCF, 0xF4, 0x08, 0x81, 0x16, 0x44, 0x83, 0xE3, 0x2D, 0x42, 0x81, 0xE4, 0x02, 0x89, 0x2F,
+    0xFD, 0x00, 0xDF, 0xF2, 0x09, 0x80, 0x90, 0x45, 0x81, 0xDD, 0x44, 0x8D, 0xE2, 0x00, 0x1E, 0xFE,
+    0x21, 0xEF, 0xE1, 0x08, 0x81, 0x1E, 0x4D, 0x80, 0xA0, 0x02, 0x88, 0xDF, 0xF2, 0x1E, 0xFE, 0x10,
+    0x08, 0x81, 0x1E, 0x45, 0x81, 0xEA, 0x46, 0x8C, 0x30, 0x0D, 0xFF, 0x20, 0xDF, 0xFA, 0x10, 0x08,
+    0x80, 0xB0, 0x45, 0x83, 0xD0, 0x5E, 0x44, 0x8D, 0x70, 0x1D, 0xFF, 0x20, 0xCF, 0xED, 0xC3, 0x07,
+    0x81, 0x3D, 0x44, 0x83, 0x40, 0x04, 0x44, 0x8F, 0x90, 0x2F, 0xFE, 0x10, 0xAF, 0xFB, 0xFF, 0x82,
+    0x05, 0x81, 0x1A, 0x42, 0x81, 0xC4, 0x03, 0x80, 0x90, 0x43, 0x9A, 0xB0, 0x4F, 0xFC, 0x00, 0x7F,
+    0xFA, 0xCF, 0xFE, 0xA7, 0x66, 0x7A, 0xEF, 0xF8, 0x20, 0x05, 0x81, 0x2E, 0x42, 0x8C, 0xA0, 0x8F,
+    0xF9, 0x00, 0x3F, 0xFD, 0x70, 0x4B, 0x80, 0xA0, 0x07, 0x80, 0xB0, 0x42, 0x85, 0x80, 0xDF, 0xF4,
+    0x02, 0x84, 0xCF, 0xF6, 0x80, 0x4A, 0x80, 0xD0, 0x07, 0x80, 0x70, 0x42, 0x85, 0x54, 0xFF, 0xD1,
+    0x02, 0x85, 0x6F, 0xFD, 0x09, 0x49, 0x80, 0xB0, 0x07, 0x88, 0x5F, 0xFE, 0x1C, 0xFF, 0x70, 0x04,
+    0x85, 0xDF, 0xF9, 0x08, 0x48, 0x80, 0x40, 0x07, 0x88, 0x4F, 0xF8, 0x6F, 0xFE, 0x10, 0x04, 0x80,
+    0x50, 0x42, 0x84, 0x50, 0x3A, 0xE0, 0x43, 0x81, 0xD5, 0x08, 0x87, 0x4F, 0xD5, 0xEF, 0xF7, 0x06,
+    0x8B, 0xAF, 0xFE, 0x40, 0x01, 0x46, 0x53, 0x0A, 0x86, 0x7E, 0x7D, 0xFF, 0xB0, 0x07, 0x85, 0x1C,
+    0xFF, 0xE5, 0x10, 0x86, 0x89, 0xDF, 0xFE, 0x20, 0x08, 0x81, 0x2E, 0x42, 0x81, 0x81, 0x0E, 0x85,
+    0x9E, 0xFF, 0xE3, 0x0A, 0x81, 0x2C, 0x42, 0x82, 0xD6, 0x10, 0x0A, 0x81, 0x5C, 0x42, 0x81, 0xD3,
+    0x0C, 0x81, 0x1A, 0x43, 0x8B, 0xD9, 0x52, 0x10, 0x01, 0x24, 0x8D, 0x43, 0x81, 0xB2, 0x0F, 0x81,
+    0x6D, 0x45, 0x83, 0xED, 0xDD, 0x45, 0x81, 0xE7, 0x12, 0x82, 0x17, 0xC0, 0x4B, 0x82, 0xD8, 0x10,
+    0x16, 0x8C, 0x48, 0xBD, 0xEF, 0xFE, 0xDC, 0x84, 0x10, 0x1B, 0x85, 0x11, 0x22, 0x21, 0x0F,
+};
+
+const image_t icon_fan = { .width = 40, .height = 40, .format = IMAGE_FORMAT_ALPHA, .colors = 0, .palette = NULL, .data = icon_fan_data };
+
+// icon_alarm: 40x40 alpha, 319 bytes, 3200 as RGB565
+static const uint8_t icon_alarm_data[] = {
+    0x02, 0x02, 0x24, 0x23, 0x10, 0x81, 0x56, 0x21, 0x81, 0xCE, 0x20, 0x83, 0x4F, 0xF6, 0x1F, 0x84,
+    0xCF, 0xFD, 0x10, 0x1D, 0x80, 0x50, 0x43, 0x80, 0x70, 0x1D, 0x80, 0xD0, 0x43, 0x81, 0xE1, 0x1B,
+    0x80, 0x60, 0x45, 0x80, 0x80, 0x1A, 0x81, 0x1D, 0x45, 0x81, 0xE2, 0x19, 0x80, 0x70, 0x47, 0x80,
+    0x90, 0x18, 0x81, 0x1E, 0x48, 0x80, 0x20, 0x17, 0x80, 0x80, 0x44, 0x80, 0xE0, 0x43, 0x80, 0xA0,
+    0x16, 0x81, 0x2E, 0x42, 0x83, 0xB2, 0x2A, 0x43, 0x80, 0x30, 0x15, 0x80, 0x90, 0x43, 0x80, 0x20,
+    0x02, 0x80, 0xE0, 0x42, 0x80, 0xB0, 0x14, 0x80, 0x20, 0x43, 0x81, 0xE1, 0x02, 0x80, 0xD0, 0x43,
+    0x80, 0x40, 0x13, 0x80, 0xA0, 0x43, 0x81, 0xE1, 0x02, 0x80, 0xD0, 0x43, 0x80, 0xB0, 0x12, 0x80,
+    0x30, 0x44, 0x81, 0xE1, 0x02, 0x80, 0xD0, 0x44, 0x80, 0x50, 0x11, 0x80, 0xA0, 0x44, 0x81, 0xE1,
+    0x02, 0x80, 0xD0, 0x44, 0x80, 0xC0, 0x10, 0x80, 0x40, 0x45, 0x81, 0xE1, 0x02, 0x80, 0xD0, 0x45,
+    0x80, 0x50, 0x0F, 0x80, 0xB0, 0x45, 0x81, 0xE1, 0x02, 0x80, 0xD0, 0x45, 0x80, 0xD0, 0x0E, 0x80,
+    0x40, 0x46, 0x81, 0xE1, 0x02, 0x80, 0xD0, 0x46, 0x80, 0x60, 0x0D, 0x80, 0xC0, 0x46, 0x81, 0xE1,
+    0x02, 0x80, 0xD0, 0x46, 0x81, 0xD1, 0x0B, 0x80, 0x50, 0x47, 0x81, 0xE1, 0x02, 0x80, 0xD0, 0x47,
+    0x80, 0x70, 0x0B, 0x80, 0xD0, 0x47, 0x81, 0xE1, 0x02, 0x80, 0xD0, 0x47, 0x81, 0xE1, 0x09, 0x80,
+    0x60, 0x49, 0x80, 0x10, 0x02, 0x80, 0xE0, 0x48, 0x80, 0x80, 0x08, 0x81, 0x1D, 0x49, 0x83, 0xA1,
+    0x18, 0x49, 0x81, 0xE2, 0x07, 0x80, 0x70, 0x4B, 0x81, 0xEE, 0x4B, 0x80, 0x90, 0x06, 0x81, 0x1E,
+    0x5A, 0x80, 0x20, 0x05, 0x80, 0x80, 0x4B, 0x83, 0xB2, 0x2A, 0x4B, 0x80, 0xA0, 0x04, 0x81, 0x2E,
+    0x4B, 0x80, 0x20, 0x02, 0x80, 0xE0, 0x4B, 0x80, 0x30, 0x03, 0x80, 0x90, 0x4B, 0x81, 0xE1, 0x02,
+    0x80, 0xD0, 0x4B, 0x80, 0xB0, 0x02, 0x80, 0x20, 0x4D, 0x83, 0xA1, 0x18, 0x4D, 0x83, 0x40, 0x0A,
+    0x4E, 0x81, 0xED, 0x4E, 0x82, 0xB0, 0x30, 0x61, 0x81, 0x5A, 0x61, 0xA4, 0xC2, 0x22, 0x22, 0x22,
+    0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x20,
+};
+
+const image_t icon_alarm = { .width = 40, .height = 40, .format = IMAGE_FORMAT_ALPHA, .colors = 0, .palette = NULL, .data = icon_alarm_data };
@@ -13,6 +13,7 @@ static inline void clock_setup(void) {
     rcc_periph_clock_enable(RCC_SPI1);
     rcc_periph_clock_enable(RCC_SPI2);
     rcc_periph_clock_enable(RCC_DMA1);
+    rcc_periph_clock_enable(RCC_SYSCFG);
 }
 
 static inline void gpio_setup(void) {
@@ -38,6 +39,8 @@ int main(void) {
     nvic_set_priority(NVIC_SYSTICK_IRQ        , configKERNEL_INTERRUPT_PRIORITY);
     nvic_set_priority(NVIC_PENDSV_IRQ         , configKERNEL_INTERRUPT_PRIORITY-1);
     nvic_set_priority(NVIC_DMA1_STREAM4_IRQ   , configKERNEL_INTERRUPT_PRIORITY-2);
+    nvic_set_priority(NVIC_SPI2_IRQ           , configKERNEL_INTERRUPT_PRIORITY-2);
+    nvic_set_priority(DISPLAY_TE_IRQ          , configKERNEL_INTERRUPT_PRIORITY-2);
 
     // System
     //nvic_set_priority(NVIC_MEM_MANAGE_IRQ, 0);